@@ -1,5 +1,7 @@
 #pragma once
 
+#include <functional>
+
 #include "rocksdb/utilities/stackable_db.h"
 
 #include "titan/options.h"
@@ -80,6 +82,70 @@ class TitanDB : public StackableDB {
   Status DestroyColumnFamilyHandle(ColumnFamilyHandle* column_family) override =
       0;
 
+  // Gets up to "length" bytes of the value of "key" starting at "offset"
+  // of the value. If the value is stored uncompressed in a blob file, only
+  // the bytes up to the end of the range are read from the file, without
+  // verifying the checksum of the record. Otherwise the value is read
+  // whole. "*value" is empty if "offset" is beyond the end of the value.
+  virtual Status GetValueRange(const ReadOptions& options,
+                               ColumnFamilyHandle* column_family,
+                               const Slice& key, uint64_t offset,
+                               uint64_t length, PinnableSlice* value) = 0;
+  virtual Status GetValueRange(const ReadOptions& options, const Slice& key,
+                               uint64_t offset, uint64_t length,
+                               PinnableSlice* value) {
+    return GetValueRange(options, DefaultColumnFamily(), key, offset, length,
+                         value);
+  }
+
+  // Called with the result of AsyncGet. The callback may take over
+  // "*value".
+  using AsyncGetCallback =
+      std::function<void(const Status& s, PinnableSlice* value)>;
+  // Called with the results of AsyncMultiGet, in the order of the keys.
+  // The callback may take over "*values".
+  using AsyncMultiGetCallback = std::function<void(
+      std::vector<Status>* statuses, std::vector<PinnableSlice>* values)>;
+
+  // Looks up "key" in the LSM tree on the calling thread, then reads the
+  // value from the blob file in the background, and calls "callback" with
+  // the result. The callback is called on the calling thread if the value
+  // is not stored in a blob file, otherwise on one of the
+  // `async_blob_read_threads` threads, so it must not block.
+  virtual void AsyncGet(const ReadOptions& options,
+                        ColumnFamilyHandle* column_family, const Slice& key,
+                        AsyncGetCallback callback) = 0;
+  virtual void AsyncGet(const ReadOptions& options, const Slice& key,
+                        AsyncGetCallback callback) {
+    AsyncGet(options, DefaultColumnFamily(), key, std::move(callback));
+  }
+
+  // Like AsyncGet, but looks up the keys on the calling thread and reads
+  // their blob values in one background batch, then calls "callback"
+  // once with all the results.
+  virtual void AsyncMultiGet(
+      const ReadOptions& options,
+      const std::vector<ColumnFamilyHandle*>& column_families,
+      const std::vector<Slice>& keys, AsyncMultiGetCallback callback) = 0;
+
+  // Reads the value of "key" in chunks of at most "chunk_size" bytes, and
+  // calls "callback" with each chunk in order until it returns false. A
+  // chunk is only valid during the call. A value stored in chunks (see
+  // TitanCFOptions::blob_value_chunk_size) is read a few stored chunks at
+  // a time, and each is delivered once its own checksum is verified, so a
+  // corruption may be reported after some chunks were delivered. Any
+  // other value is read whole and verified before the first chunk.
+  virtual Status GetValueChunks(
+      const ReadOptions& options, ColumnFamilyHandle* column_family,
+      const Slice& key, size_t chunk_size,
+      const std::function<bool(const Slice&)>& callback) = 0;
+  virtual Status GetValueChunks(
+      const ReadOptions& options, const Slice& key, size_t chunk_size,
+      const std::function<bool(const Slice&)>& callback) {
+    return GetValueChunks(options, DefaultColumnFamily(), key, chunk_size,
+                          callback);
+  }
+
   using StackableDB::NewIterator;
   Iterator* NewIterator(const ReadOptions& opts,
                         ColumnFamilyHandle* column_family) override {
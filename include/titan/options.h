@@ -37,6 +37,41 @@ struct TitanDBOptions : public DBOptions {
   // Default: 600 (10 min)
   uint32_t titan_stats_dump_period_sec{600};
 
+  // The maximum number of blob file readers kept open by Titan. It is the
+  // fd budget of blob files, separate from the SST files limited by
+  // `max_open_files`. A value of -1 means following `max_open_files`, or
+  // unlimited if `max_open_files` is -1 too.
+  //
+  // Default: -1
+  int max_open_blob_files{-1};
+
+  // The cache of opened blob file readers is sharded to this number of
+  // bits, like `table_cache_numshardbits` for SST files. A value of -1
+  // means choosing the number of shards from the cache capacity.
+  //
+  // Default: -1
+  int blob_file_cache_numshardbits{-1};
+
+  // The number of background threads serving the blob reads of AsyncGet
+  // and AsyncMultiGet. The threads are started on the first async read.
+  //
+  // Default: 4
+  int32_t async_blob_read_threads{4};
+
+  // If true, the locations of the records in the blob caches are saved on
+  // Close(), and the records are read into the blob caches again in the
+  // background after the DB is reopened, so that the cached working set
+  // recovers soon after a restart.
+  //
+  // Default: false
+  bool blob_cache_warmup{false};
+
+  // The rate limit of the reads of the blob cache warm-up in bytes per
+  // second. 0 means unlimited.
+  //
+  // Default: 16MB
+  uint64_t blob_cache_warmup_bytes_per_sec{16 << 20};
+
   TitanDBOptions() = default;
   explicit TitanDBOptions(const DBOptions& options) : DBOptions(options) {}
 
@@ -87,7 +122,9 @@ struct TitanCFOptions : public ColumnFamilyOptions {
   // The compression options. The `blob_file_compression.enabled` option is
   // ignored, we only use `blob_file_compression` above to determine wether the
   // blob file is compressed. We use this options mainly to configure the
-  // compression dictionary.
+  // compression dictionary. If `parallel_threads` is greater than 1, each
+  // blob file builder compresses the records with up to that many threads
+  // of a pool shared by the DB.
   CompressionOptions blob_file_compression_options;
 
   // The desirable blob file size. This is not a hard limit but a wish.
@@ -95,11 +132,81 @@ struct TitanCFOptions : public ColumnFamilyOptions {
   // Default: 256MB
   uint64_t blob_file_target_size{256 << 20};
 
-  // If non-NULL use the specified cache for blob records.
+  // If positive, a value larger than this is stored in chunks of this size,
+  // each with its own checksum, so that TitanDB::GetValueChunks() reads and
+  // verifies the value a few chunks at a time instead of whole. Such a
+  // record is stored uncompressed. Blob files with chunked values can't be
+  // read by versions of Titan without this option.
+  //
+  // Default: 0 (values are not chunked)
+  uint32_t blob_value_chunk_size{0};
+
+  // If non-NULL use the specified cache for blob records. Records evicted
+  // from it can be spilled to a local disk with a secondary cache, see
+  // NewBlobSecondaryCache() in titan/secondary_cache.h.
   //
   // Default: nullptr
   std::shared_ptr<Cache> blob_cache;
 
+  // If positive, a compressed blob record is kept in the blob cache in its
+  // compressed form and uncompressed on every cache hit, as long as its
+  // compression ratio (uncompressed size / compressed size) is not less
+  // than this value. It trades CPU for more records held by the same
+  // blob cache. Set it to 1 to cache all compressed records compressed.
+  //
+  // Default: 0 (records are cached uncompressed)
+  double blob_cache_compressed_ratio{0};
+
+  // If greater than 1, a blob record missed in the blob cache is inserted
+  // only if it has been read at least this many times recently, so that a
+  // one-pass scan doesn't flush the cached working set. The reads are
+  // counted by a TinyLFU-style frequency sketch of each column family,
+  // whose counts are halved periodically and saturate at 15. Regardless of
+  // this option, reads with `ReadOptions::fill_cache` false never insert.
+  //
+  // Default: 0 (records are always inserted)
+  uint32_t blob_cache_admission_frequency{0};
+
+  // If true, the blob records written by flush and compaction are inserted
+  // into the blob cache as they are written, so that recently written
+  // values are read from the cache. It suits workloads reading what they
+  // have just written, and flushes the cached working set otherwise.
+  //
+  // Default: false
+  bool blob_cache_fill_on_flush{false};
+
+  // If true, a blob record relocated by GC or level merge is inserted into
+  // the blob cache under its new location, if it was cached under the old
+  // location. Otherwise the hot records turn into cache misses after every
+  // GC, as the blob cache is keyed by the location of the records.
+  //
+  // Default: false
+  bool blob_cache_fill_on_gc{false};
+
+  // If true, the readahead of blob iterators and the reads of GC are
+  // issued as batches of requests through `FSRandomAccessFile::MultiRead`,
+  // and served from the read buffers. Titan doesn't submit the I/O by
+  // itself: io_uring is used only if the file system's MultiRead uses it,
+  // as the default posix one does when RocksDB is built with liburing and
+  // the kernel supports it. Otherwise the requests fall back to pread.
+  //
+  // Default: false
+  bool blob_batched_read{false};
+
+  // If true, the values at least `min_blob_size` are separated when they
+  // are written, instead of when the memtable is flushed. The values are
+  // appended to a blob log of the column family, and only their blob
+  // indexes go through the WAL and the memtable, which saves writing the
+  // values twice before the flush. The blob log is sealed as a blob file
+  // when the column family is flushed or when it reaches
+  // `blob_file_target_size`, and only then is it picked by GC. A blob log
+  // left by a crash is recovered on reopen.
+  //
+  // Requirement: blob_file_compression_options.max_dict_bytes = 0 and
+  // allow_mmap_reads = false
+  // Default: false
+  bool separate_blob_on_write{false};
+
   // Max batch size for GC.
   //
   // Default: 1GB
@@ -182,7 +289,14 @@ struct ImmutableTitanCFOptions {
       : min_blob_size(opts.min_blob_size),
         blob_file_compression(opts.blob_file_compression),
         blob_file_target_size(opts.blob_file_target_size),
+        blob_value_chunk_size(opts.blob_value_chunk_size),
         blob_cache(opts.blob_cache),
+        blob_cache_compressed_ratio(opts.blob_cache_compressed_ratio),
+        blob_cache_admission_frequency(opts.blob_cache_admission_frequency),
+        blob_cache_fill_on_flush(opts.blob_cache_fill_on_flush),
+        blob_cache_fill_on_gc(opts.blob_cache_fill_on_gc),
+        blob_batched_read(opts.blob_batched_read),
+        separate_blob_on_write(opts.separate_blob_on_write),
         max_gc_batch_size(opts.max_gc_batch_size),
         min_gc_batch_size(opts.min_gc_batch_size),
         blob_file_discardable_ratio(opts.blob_file_discardable_ratio),
@@ -196,8 +310,22 @@ struct ImmutableTitanCFOptions {
 
   uint64_t blob_file_target_size;
 
+  uint32_t blob_value_chunk_size;
+
   std::shared_ptr<Cache> blob_cache;
 
+  double blob_cache_compressed_ratio;
+
+  uint32_t blob_cache_admission_frequency;
+
+  bool blob_cache_fill_on_flush;
+
+  bool blob_cache_fill_on_gc;
+
+  bool blob_batched_read;
+
+  bool separate_blob_on_write;
+
   uint64_t max_gc_batch_size;
 
   uint64_t min_gc_batch_size;
@@ -249,6 +377,33 @@ struct TitanReadOptions : public ReadOptions {
   // Default: false
   bool key_only{false};
 
+  // If non-zero, the iterator buffers up to this many entries ahead of the
+  // current position on forward iteration, and reads the blob values of
+  // the buffered entries in one batch, so that reads to different blob
+  // files are issued together instead of one at a time.
+  //
+  // Default: 0 (disabled)
+  size_t blob_lookahead_window{0};
+
+  // If true, the iterator only decodes the blob index when it is positioned,
+  // and reads the blob value the first time value() is called on the entry.
+  // It benefits scans that skip most entries by key. The lookahead window
+  // is not used in this mode.
+  //
+  // Default: false
+  bool lazy_blob_value{false};
+
+  // If non-zero and `iterate_upper_bound` is set, the first forward seek
+  // of the iterator walks the blob indexes up to the upper bound, and
+  // prefetches the range of each blob file covering the records the scan
+  // will read, up to this many bytes in total. The walk itself stops after
+  // visiting this many bytes of keys and values in the base DB. It turns
+  // the scattered reads of a short bounded scan into a few large reads
+  // issued up front, within the deadline of the read.
+  //
+  // Default: 0 (disabled)
+  uint64_t bounded_scan_prefetch_size{0};
+
   TitanReadOptions() = default;
   explicit TitanReadOptions(const ReadOptions& options)
       : ReadOptions(options) {}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "rocksdb/env.h"
+#include "rocksdb/secondary_cache.h"
+
+namespace rocksdb {
+namespace titandb {
+
+struct BlobSecondaryCacheOptions {
+  // The directory to store the cached blob records, usually on a local
+  // fast disk. Records already in the directory are reloaded on open, so
+  // the cache survives restarts.
+  std::string path;
+
+  // The max total size of the cache files. The oldest cache files are
+  // dropped when it is exceeded.
+  //
+  // Default: 8GB
+  uint64_t capacity{8ull << 30};
+
+  // The size of each cache file. Records are buffered in memory and
+  // written out one cache file at a time.
+  //
+  // Default: 64MB
+  uint64_t file_size{64 << 20};
+
+  // The environment to access the cache files.
+  //
+  // Default: Env::Default()
+  Env* env{Env::Default()};
+};
+
+// Creates a secondary cache of blob records backed by files in
+// "options.path". Set it as `LRUCacheOptions::secondary_cache` of the
+// cache used as `TitanCFOptions::blob_cache`, then records evicted from
+// the blob cache are spilled to the files, and a blob cache miss is
+// served from the files before reading the blob file.
+Status NewBlobSecondaryCache(const BlobSecondaryCacheOptions& options,
+                             std::shared_ptr<SecondaryCache>* result);
+
+}  // namespace titandb
+}  // namespace rocksdb
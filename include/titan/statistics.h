@@ -55,6 +55,10 @@ enum TickerType : uint32_t {
   // the times of triggering next round of GC actively
   TITAN_GC_TRIGGER_NEXT,
 
+  // the count of blob cache misses not inserted into the blob cache due to
+  // the admission
+  TITAN_BLOB_CACHE_ADMISSION_REJECT,
+
   TITAN_TICKER_ENUM_MAX,
 };
 
@@ -91,6 +95,7 @@ const std::vector<std::pair<TickerType, std::string>> TitanTickersNameMap = {
     {TITAN_GC_FAILURE, "titandb.gc.failure"},
     {TITAN_GC_SUCCESS, "titandb.gc.success"},
     {TITAN_GC_TRIGGER_NEXT, "titandb.gc.trigger.next"},
+    {TITAN_BLOB_CACHE_ADMISSION_REJECT, "titandb.blob.cache.admission.reject"},
 };
 
 enum HistogramType : uint32_t {
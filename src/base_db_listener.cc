@@ -11,6 +11,13 @@ BaseDbListener::BaseDbListener(TitanDBImpl* db) : db_impl_(db) {
 
 BaseDbListener::~BaseDbListener() {}
 
+void BaseDbListener::OnFlushBegin(DB* /*db*/,
+                                  const FlushJobInfo& flush_job_info) {
+  if (db_impl_->initialized()) {
+    db_impl_->OnFlushBegin(flush_job_info);
+  }
+}
+
 void BaseDbListener::OnFlushCompleted(DB* /*db*/,
                                       const FlushJobInfo& flush_job_info) {
   if (db_impl_->initialized()) {
@@ -3,14 +3,31 @@
 #include "table/block_based/block_based_table_reader.h"
 #include "table/meta_blocks.h"
 #include "util/crc32c.h"
+#include "util/mutexlock.h"
 
 namespace rocksdb {
 namespace titandb {
 
+namespace {
+
+// Bounds the memory held by the records in the compression pipeline.
+const size_t kMaxPendingRecordsPerThread = 4;
+
+void CompressRecord(BlobEncoder* encoder, const std::string& record,
+                    std::string* encoded) {
+  encoder->EncodeSlice(record);
+  encoded->reserve(encoder->GetEncodedSize());
+  encoded->append(encoder->GetHeader().data(), encoder->GetHeader().size());
+  encoded->append(encoder->GetRecord().data(), encoder->GetRecord().size());
+}
+
+}  // namespace
+
 BlobFileBuilder::BlobFileBuilder(const TitanDBOptions& db_options,
                                  const TitanCFOptions& cf_options,
                                  WritableFileWriter* file,
-                                 uint32_t blob_file_version)
+                                 uint32_t blob_file_version,
+                                 ThreadPool* compression_pool)
     : builder_state_(cf_options.blob_file_compression_options.max_dict_bytes > 0
                          ? BuilderState::kBuffered
                          : BuilderState::kUnbuffered),
@@ -18,7 +35,8 @@ BlobFileBuilder::BlobFileBuilder(const TitanDBOptions& db_options,
       file_(file),
       blob_file_version_(blob_file_version),
       encoder_(cf_options.blob_file_compression,
-               cf_options.blob_file_compression_options) {
+               cf_options.blob_file_compression_options),
+      compression_pool_(compression_pool) {
   status_ = BlobFileHeader::ValidateVersion(blob_file_version_);
   if (!status_.ok()) {
     return;
@@ -34,8 +52,18 @@ BlobFileBuilder::BlobFileBuilder(const TitanDBOptions& db_options,
 #endif
   }
   WriteHeader();
+  encoder_.SetValueChunkSize(cf_options_.blob_value_chunk_size);
+  uint32_t threads = cf_options_.blob_file_compression_options.parallel_threads;
+  if (ok() && compression_pool_ != nullptr && threads > 1 &&
+      cf_options_.blob_file_compression != kNoCompression) {
+    max_pending_ = kMaxPendingRecordsPerThread * threads;
+    max_jobs_ = threads;
+    pipeline_ = std::make_shared<Pipeline>(cf_options_);
+  }
 }
 
+BlobFileBuilder::~BlobFileBuilder() { StopPipeline(); }
+
 void BlobFileBuilder::WriteHeader() {
   BlobFileHeader header;
   header.version = blob_file_version_;
@@ -56,7 +84,7 @@ void BlobFileBuilder::Add(const BlobRecord& record,
   if (builder_state_ == BuilderState::kBuffered) {
     std::string record_str;
     // Encode to take ownership of underlying string.
-    record.EncodeTo(&record_str);
+    record.EncodeTo(&record_str, cf_options_.blob_value_chunk_size);
     sample_records_.emplace_back(record_str);
     sample_str_len_ += record_str.size();
     cached_contexts_.emplace_back(std::move(ctx));
@@ -65,6 +93,11 @@ void BlobFileBuilder::Add(const BlobRecord& record,
             cf_options_.blob_file_compression_options.zstd_max_train_bytes) {
       EnterUnbuffered(out_ctx);
     }
+  } else if (pipelined()) {
+    std::string record_str;
+    record.EncodeTo(&record_str, cf_options_.blob_value_chunk_size);
+    SubmitRecord(std::move(record_str), std::move(ctx));
+    WritePendingRecords(max_pending_, out_ctx);
   } else {
     encoder_.EncodeRecord(record);
     WriteEncoderData(&ctx->new_blob_index.blob_handle);
@@ -83,6 +116,11 @@ void BlobFileBuilder::Add(const BlobRecord& record,
 }
 
 void BlobFileBuilder::AddSmall(std::unique_ptr<BlobRecordContext> ctx) {
+  if (builder_state_ == BuilderState::kUnbuffered && pipelined()) {
+    // Keeps the order with the records still being compressed.
+    SubmitRecord(std::string(), std::move(ctx));
+    return;
+  }
   cached_contexts_.emplace_back(std::move(ctx));
 }
 
@@ -107,6 +145,10 @@ void BlobFileBuilder::EnterUnbuffered(OutContexts* out_ctx) {
       new CompressionDict(dict, cf_options_.blob_file_compression,
                           cf_options_.blob_file_compression_options.level));
   encoder_.SetCompressionDict(compression_dict_.get());
+  if (pipelined()) {
+    MutexLock l(&pipeline_->mutex);
+    pipeline_->compression_dict = compression_dict_.get();
+  }
 
   FlushSampleRecords(out_ctx);
 
@@ -115,6 +157,22 @@ void BlobFileBuilder::EnterUnbuffered(OutContexts* out_ctx) {
 
 void BlobFileBuilder::FlushSampleRecords(OutContexts* out_ctx) {
   assert(cached_contexts_.size() >= sample_records_.size());
+  if (pipelined()) {
+    size_t sample_idx = 0;
+    for (auto& ctx : cached_contexts_) {
+      std::string record_str;
+      if (!ctx->has_value) {
+        record_str = std::move(sample_records_[sample_idx++]);
+      }
+      SubmitRecord(std::move(record_str), std::move(ctx));
+      WritePendingRecords(max_pending_, out_ctx);
+    }
+    assert(sample_idx == sample_records_.size());
+    sample_records_.clear();
+    sample_str_len_ = 0;
+    cached_contexts_.clear();
+    return;
+  }
   size_t sample_idx = 0, ctx_idx = 0;
   for (; sample_idx < sample_records_.size(); sample_idx++, ctx_idx++) {
     const std::string& record_str = sample_records_[sample_idx];
@@ -140,18 +198,127 @@ void BlobFileBuilder::FlushSampleRecords(OutContexts* out_ctx) {
 }
 
 void BlobFileBuilder::WriteEncoderData(BlobHandle* handle) {
+  WriteRecord(encoder_.GetHeader(), encoder_.GetRecord(), handle);
+}
+
+void BlobFileBuilder::WriteRecord(const Slice& header, const Slice& record,
+                                  BlobHandle* handle) {
   handle->offset = file_->GetFileSize();
-  handle->size = encoder_.GetEncodedSize();
+  handle->size = header.size() + record.size();
   handle->order = num_entries_;
   live_data_size_ += handle->size;
 
-  status_ = file_->Append(encoder_.GetHeader());
+  status_ = file_->Append(header);
   if (ok()) {
-    status_ = file_->Append(encoder_.GetRecord());
+    status_ = file_->Append(record);
     num_entries_++;
   }
 }
 
+void BlobFileBuilder::SubmitRecord(std::string&& record,
+                                   std::unique_ptr<BlobRecordContext> ctx) {
+  std::unique_ptr<PendingRecord> pending(new PendingRecord);
+  pending->ctx = std::move(ctx);
+  pending->record = std::move(record);
+  if (pending->record.empty()) {
+    pending->done = true;
+    pending_.push_back(std::move(pending));
+    return;
+  }
+  bool new_job = false;
+  {
+    MutexLock l(&pipeline_->mutex);
+    pipeline_->queue.push_back(pending.get());
+    // A running job picks the record before it finishes.
+    if (pipeline_->num_jobs < max_jobs_) {
+      pipeline_->num_jobs++;
+      new_job = true;
+    }
+  }
+  pending_.push_back(std::move(pending));
+  if (new_job) {
+    std::shared_ptr<Pipeline> pipeline = pipeline_;
+    compression_pool_->SubmitJob(
+        [pipeline]() { BGWorkCompression(pipeline); });
+  }
+}
+
+void BlobFileBuilder::WritePendingRecords(size_t max_pending,
+                                          OutContexts* out_ctx) {
+  while (!pending_.empty() && ok()) {
+    PendingRecord* pending = pending_.front().get();
+    bool picked = false;
+    {
+      MutexLock l(&pipeline_->mutex);
+      if (!pending->done && pending_.size() <= max_pending) {
+        return;
+      }
+      // The pool is busy, so compresses the record here instead of
+      // waiting for a job to pick it.
+      std::deque<PendingRecord*>& queue = pipeline_->queue;
+      if (!pending->done && !queue.empty() && queue.front() == pending) {
+        queue.pop_front();
+        picked = true;
+      }
+      while (!picked && !pending->done) {
+        pipeline_->cv.Wait();
+      }
+    }
+    if (picked) {
+      CompressRecord(&encoder_, pending->record, &pending->encoded);
+      pending->done = true;
+    }
+    if (!pending->encoded.empty()) {
+      const std::string& encoded = pending->encoded;
+      WriteRecord(Slice(encoded.data(), kRecordHeaderSize),
+                  Slice(encoded.data() + kRecordHeaderSize,
+                        encoded.size() - kRecordHeaderSize),
+                  &pending->ctx->new_blob_index.blob_handle);
+    }
+    out_ctx->emplace_back(std::move(pending->ctx));
+    pending_.pop_front();
+  }
+}
+
+void BlobFileBuilder::BGWorkCompression(
+    const std::shared_ptr<Pipeline>& pipeline) {
+  // Each job compresses with its own encoder, which holds the compression
+  // context.
+  BlobEncoder encoder(pipeline->compression, pipeline->compression_options);
+  const CompressionDict* compression_dict = nullptr;
+  MutexLock l(&pipeline->mutex);
+  while (!pipeline->queue.empty()) {
+    PendingRecord* pending = pipeline->queue.front();
+    pipeline->queue.pop_front();
+    // The dictionary is set before the records to compress with it are
+    // queued.
+    if (pipeline->compression_dict != compression_dict) {
+      compression_dict = pipeline->compression_dict;
+      encoder.SetCompressionDict(compression_dict);
+    }
+    pipeline->num_running++;
+    pipeline->mutex.Unlock();
+
+    CompressRecord(&encoder, pending->record, &pending->encoded);
+
+    pipeline->mutex.Lock();
+    pending->done = true;
+    pipeline->num_running--;
+    pipeline->cv.SignalAll();
+  }
+  pipeline->num_jobs--;
+}
+
+void BlobFileBuilder::StopPipeline() {
+  if (!pipelined()) return;
+  MutexLock l(&pipeline_->mutex);
+  // The jobs started later find nothing to compress.
+  pipeline_->queue.clear();
+  while (pipeline_->num_running > 0) {
+    pipeline_->cv.Wait();
+  }
+}
+
 void BlobFileBuilder::WriteRawBlock(const Slice& block, BlockHandle* handle) {
   handle->set_offset(file_->GetFileSize());
   handle->set_size(block.size());
@@ -187,6 +354,11 @@ Status BlobFileBuilder::Finish(OutContexts* out_ctx) {
   if (builder_state_ == BuilderState::kBuffered) {
     EnterUnbuffered(out_ctx);
   }
+  if (pipelined()) {
+    WritePendingRecords(0 /*max_pending*/, out_ctx);
+    StopPipeline();
+    if (!ok()) return status();
+  }
 
   BlobFileFooter footer;
   // if has compression dictionary, encode it into meta blocks
@@ -210,7 +382,7 @@ Status BlobFileBuilder::Finish(OutContexts* out_ctx) {
   return status();
 }
 
-void BlobFileBuilder::Abandon() {}
+void BlobFileBuilder::Abandon() { StopPipeline(); }
 
 uint64_t BlobFileBuilder::NumEntries() { return num_entries_; }
 
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <deque>
+
 #include "file/writable_file_writer.h"
+#include "port/port.h"
+#include "rocksdb/threadpool.h"
 #include "table/meta_blocks.h"
 #include "util/autovector.h"
 #include "util/compression.h"
@@ -34,6 +38,11 @@ namespace titandb {
 // meta index block with block handles pointed to the meta blocks. The
 // meta block and the meta index block are formatted the same as the
 // BlockBasedTable.
+//
+// If `blob_file_compression_options.parallel_threads` is greater than 1
+// and a compression pool is given, the records are compressed by up to
+// that many jobs in the pool, and written by the thread calling Add() or
+// Finish() in the order they are added.
 class BlobFileBuilder {
  public:
   // States of the builder.
@@ -61,26 +70,36 @@ class BlobFileBuilder {
     BlobIndex new_blob_index;
     bool has_value = false;
     std::string value;
+    // If not empty, the encoded record to insert into the blob cache under
+    // "new_blob_index" once the record is written.
+    std::string cache_record;
   };
   typedef autovector<std::unique_ptr<BlobRecordContext>> OutContexts;
 
   // Constructs a builder that will store the contents of the file it
   // is building in "*file". Does not close the file. It is up to the
   // caller to sync and close the file after calling Finish().
+  // "compression_pool", if not null, runs the parallel compression, and
+  // must outlive the builder.
   BlobFileBuilder(const TitanDBOptions& db_options,
                   const TitanCFOptions& cf_options, WritableFileWriter* file,
-                  uint32_t blob_file_version = BlobFileHeader::kVersion2);
+                  uint32_t blob_file_version = BlobFileHeader::kVersion2,
+                  ThreadPool* compression_pool = nullptr);
+
+  ~BlobFileBuilder();
 
   // Tries to add the record to the file
   // Notice:
-  // 1. The `out_ctx` might be empty when builder is in `kBuffered` state.
+  // 1. The `out_ctx` might be empty when builder is in `kBuffered` state,
+  //    or when the records added before are still being compressed.
   // 2. Caller should set `ctx.new_blob_index.file_number` before pass it in,
   //    the file builder will only change the `blob_handle` of it
   void Add(const BlobRecord& record, std::unique_ptr<BlobRecordContext> ctx,
            OutContexts* out_ctx);
 
   // AddSmall is used to prevent the disorder issue, small KV pairs and blob
-  // index block may be passed in here
+  // index block may be passed in here. It is also called in `kUnbuffered`
+  // state while NumPendingEntries() is not zero.
   void AddSmall(std::unique_ptr<BlobRecordContext> ctx);
 
   // Returns builder state
@@ -104,6 +123,8 @@ class BlobFileBuilder {
   uint64_t NumEntries();
   // Number of sample records
   uint64_t NumSampleEntries() { return sample_records_.size(); }
+  // Number of contexts added in `kUnbuffered` state but not output yet.
+  uint64_t NumPendingEntries() const { return pending_.size(); }
 
   const std::string& GetSmallestKey() { return smallest_key_; }
   const std::string& GetLargestKey() { return largest_key_; }
@@ -123,6 +144,54 @@ class BlobFileBuilder {
   void WriteCompressionDictBlock(MetaIndexBuilder* meta_index_builder);
   void FlushSampleRecords(OutContexts* out_ctx);
   void WriteEncoderData(BlobHandle* handle);
+  void WriteRecord(const Slice& header, const Slice& record,
+                   BlobHandle* handle);
+
+  // A context in the compression pipeline.
+  struct PendingRecord {
+    std::unique_ptr<BlobRecordContext> ctx;
+    // The record to compress, empty for a small context.
+    std::string record;
+    // The encoded header and compressed record, set by a job.
+    std::string encoded;
+    bool done = false;
+  };
+
+  // The state shared with the compression jobs. A job may start after the
+  // builder is destroyed, so it holds a reference to the state.
+  struct Pipeline {
+    explicit Pipeline(const TitanCFOptions& cf_options)
+        : compression(cf_options.blob_file_compression),
+          compression_options(cf_options.blob_file_compression_options),
+          cv(&mutex) {}
+
+    const CompressionType compression;
+    const CompressionOptions compression_options;
+    // Protects the following and `PendingRecord::done`.
+    port::Mutex mutex;
+    port::CondVar cv;
+    // The records not picked by any job yet.
+    std::deque<PendingRecord*> queue;
+    const CompressionDict* compression_dict = nullptr;
+    // The number of jobs submitted to the pool and not finished.
+    uint32_t num_jobs = 0;
+    // The number of records being compressed by the jobs.
+    uint32_t num_running = 0;
+  };
+
+  bool pipelined() const { return pipeline_ != nullptr; }
+  // Drops the records not picked by any job, and waits for the ones being
+  // compressed.
+  void StopPipeline();
+  static void BGWorkCompression(const std::shared_ptr<Pipeline>& pipeline);
+  // Queues the context to be output after the ones added before it, and
+  // the record, if not empty, to be compressed by the jobs.
+  void SubmitRecord(std::string&& record,
+                    std::unique_ptr<BlobRecordContext> ctx);
+  // Writes the compressed records and outputs the contexts at the front of
+  // the pipeline, until the first one still being compressed, waiting for
+  // it if more than "max_pending" contexts are queued.
+  void WritePendingRecords(size_t max_pending, OutContexts* out_ctx);
 
   TitanCFOptions cf_options_;
   WritableFileWriter* file_;
@@ -142,6 +211,14 @@ class BlobFileBuilder {
   std::string smallest_key_;
   std::string largest_key_;
   uint64_t live_data_size_ = 0;
+
+  // The contexts in the order they are added. Only accessed by the thread
+  // calling Add() or Finish().
+  std::deque<std::unique_ptr<PendingRecord>> pending_;
+  size_t max_pending_ = 0;
+  ThreadPool* compression_pool_;
+  uint32_t max_jobs_ = 0;
+  std::shared_ptr<Pipeline> pipeline_;
 };
 
 }  // namespace titandb
@@ -1,6 +1,10 @@
 #include "blob_file_cache.h"
 
+#include <algorithm>
+
 #include "file/filename.h"
+#include "test_util/sync_point.h"
+#include "util/mutexlock.h"
 
 #include "util.h"
 
@@ -9,6 +13,11 @@ namespace titandb {
 
 namespace {
 
+// Bounds of the size of the admission sketch.
+const size_t kMinAdmissionCounters = 1 << 10;
+const size_t kMaxAdmissionCounters = 1 << 24;
+const uint64_t kMinAdmissionRecordSize = 1 << 10;
+
 Slice EncodeFileNumber(const uint64_t* number) {
   return Slice(reinterpret_cast<const char*>(number), sizeof(*number));
 }
@@ -17,13 +26,26 @@ Slice EncodeFileNumber(const uint64_t* number) {
 
 BlobFileCache::BlobFileCache(const TitanDBOptions& db_options,
                              const TitanCFOptions& cf_options,
-                             std::shared_ptr<Cache> cache, TitanStats* stats)
+                             std::shared_ptr<Cache> cache, TitanStats* stats,
+                             uint32_t blob_cache_id)
     : env_(db_options.env),
       env_options_(db_options),
       db_options_(db_options),
       cf_options_(cf_options),
       cache_(cache),
-      stats_(stats) {}
+      stats_(stats),
+      blob_cache_id_(blob_cache_id) {
+  if (cf_options_.blob_cache &&
+      cf_options_.blob_cache_admission_frequency > 1) {
+    // One counter for each record the blob cache can hold, assuming
+    // records of the min blob size.
+    size_t num_counters =
+        cf_options_.blob_cache->GetCapacity() /
+        std::max<uint64_t>(cf_options_.min_blob_size, kMinAdmissionRecordSize);
+    admission_ = std::make_shared<FrequencySketch>(std::min(
+        std::max(num_counters, kMinAdmissionCounters), kMaxAdmissionCounters));
+  }
+}
 
 Status BlobFileCache::Get(const ReadOptions& options, uint64_t file_number,
                           uint64_t file_size, const BlobHandle& handle,
@@ -38,6 +60,61 @@ Status BlobFileCache::Get(const ReadOptions& options, uint64_t file_number,
   return s;
 }
 
+Status BlobFileCache::GetRange(const ReadOptions& options,
+                               uint64_t file_number, uint64_t file_size,
+                               const BlobHandle& handle, const Slice& key,
+                               uint64_t offset, uint64_t length,
+                               PinnableSlice* value) {
+  Cache::Handle* cache_handle = nullptr;
+  Status s = FindFile(file_number, file_size, &cache_handle);
+  if (!s.ok()) return s;
+
+  auto reader = reinterpret_cast<BlobFileReader*>(cache_->Value(cache_handle));
+  s = reader->GetRange(options, handle, key, offset, length, value);
+  cache_->Release(cache_handle);
+  return s;
+}
+
+Status BlobFileCache::LoadIntoCache(uint64_t file_number, uint64_t file_size,
+                                    uint64_t offset,
+                                    RateLimiter* rate_limiter) {
+  Cache::Handle* cache_handle = nullptr;
+  Status s = FindFile(file_number, file_size, &cache_handle);
+  if (!s.ok()) return s;
+
+  auto reader = reinterpret_cast<BlobFileReader*>(cache_->Value(cache_handle));
+  s = reader->LoadIntoCache(offset, rate_limiter);
+  cache_->Release(cache_handle);
+  return s;
+}
+
+Status BlobFileCache::GetChunks(
+    const ReadOptions& options, uint64_t file_number, uint64_t file_size,
+    const BlobHandle& handle, const Slice& key, size_t chunk_size,
+    const std::function<bool(const Slice&)>& callback) {
+  Cache::Handle* cache_handle = nullptr;
+  Status s = FindFile(file_number, file_size, &cache_handle);
+  if (!s.ok()) return s;
+
+  auto reader = reinterpret_cast<BlobFileReader*>(cache_->Value(cache_handle));
+  s = reader->GetChunks(options, handle, key, chunk_size, callback);
+  cache_->Release(cache_handle);
+  return s;
+}
+
+Status BlobFileCache::MultiGet(const ReadOptions& options,
+                               uint64_t file_number, uint64_t file_size,
+                               std::vector<BlobReadRequest>* requests) {
+  Cache::Handle* cache_handle = nullptr;
+  Status s = FindFile(file_number, file_size, &cache_handle);
+  if (!s.ok()) return s;
+
+  auto reader = reinterpret_cast<BlobFileReader*>(cache_->Value(cache_handle));
+  reader->MultiGet(options, requests);
+  cache_->Release(cache_handle);
+  return s;
+}
+
 Status BlobFileCache::NewPrefetcher(
     uint64_t file_number, uint64_t file_size,
     std::unique_ptr<BlobFilePrefetcher>* result) {
@@ -65,6 +142,14 @@ Status BlobFileCache::FindFile(uint64_t file_number, uint64_t file_size,
     // TODO: add file reader cache hit/miss metrics
     return s;
   }
+
+  MutexLock l(GetLoaderMutex(file_number));
+  // The file may have been opened by another thread while waiting.
+  *handle = cache_->Lookup(cache_key);
+  if (*handle) {
+    return s;
+  }
+  TEST_SYNC_POINT("BlobFileCache::FindFile:OpenFile");
   std::unique_ptr<RandomAccessFileReader> file;
   {
     std::unique_ptr<FSRandomAccessFile> f;
@@ -79,8 +164,9 @@ Status BlobFileCache::FindFile(uint64_t file_number, uint64_t file_size,
   }
 
   std::unique_ptr<BlobFileReader> reader;
-  s = BlobFileReader::Open(cf_options_, std::move(file), file_size, &reader,
-                           stats_);
+  s = BlobFileReader::Open(cf_options_, std::move(file), file_number, file_size,
+                           &reader, stats_, env_->GetSystemClock().get(),
+                           blob_cache_id_, admission_);
   if (!s.ok()) return s;
 
   cache_->Insert(cache_key, reader.release(), 1,
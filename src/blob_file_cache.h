@@ -1,5 +1,6 @@
 #pragma once
 
+#include "port/port.h"
 #include "rocksdb/options.h"
 
 #include "blob_file_reader.h"
@@ -12,10 +13,11 @@ namespace titandb {
 
 class BlobFileCache {
  public:
-  // Constructs a blob file cache to cache opened files.
+  // Constructs a blob file cache to cache opened files. The opened
+  // readers use "blob_cache_id" in their blob cache keys.
   BlobFileCache(const TitanDBOptions& db_options,
                 const TitanCFOptions& cf_options, std::shared_ptr<Cache> cache,
-                TitanStats* stats);
+                TitanStats* stats, uint32_t blob_cache_id = 0);
 
   // Gets the blob record pointed by the handle in the specified file
   // number. The corresponding file size must be exactly "file_size"
@@ -25,6 +27,30 @@ class BlobFileCache {
              uint64_t file_size, const BlobHandle& handle, BlobRecord* record,
              PinnableSlice* buffer);
 
+  // Gets the blob records pointed by the requests in the specified file
+  // number. See BlobFileReader::MultiGet.
+  Status MultiGet(const ReadOptions& options, uint64_t file_number,
+                  uint64_t file_size, std::vector<BlobReadRequest>* requests);
+
+  // Gets a range of the value of the blob record pointed by the handle in
+  // the specified file number. See BlobFileReader::GetRange.
+  Status GetRange(const ReadOptions& options, uint64_t file_number,
+                  uint64_t file_size, const BlobHandle& handle,
+                  const Slice& key, uint64_t offset, uint64_t length,
+                  PinnableSlice* value);
+
+  // Reads the value of the blob record pointed by the handle in the
+  // specified file number in chunks. See BlobFileReader::GetChunks.
+  Status GetChunks(const ReadOptions& options, uint64_t file_number,
+                   uint64_t file_size, const BlobHandle& handle,
+                   const Slice& key, size_t chunk_size,
+                   const std::function<bool(const Slice&)>& callback);
+
+  // Reads the record at "offset" of the specified file number into the
+  // blob cache. See BlobFileReader::LoadIntoCache.
+  Status LoadIntoCache(uint64_t file_number, uint64_t file_size,
+                       uint64_t offset, RateLimiter* rate_limiter);
+
   // Creates a prefetcher for the specified file number.
   Status NewPrefetcher(uint64_t file_number, uint64_t file_size,
                        std::unique_ptr<BlobFilePrefetcher>* result);
@@ -39,12 +65,25 @@ class BlobFileCache {
   Status FindFile(uint64_t file_number, uint64_t file_size,
                   Cache::Handle** handle);
 
+  // Serializes the opens of the same file, so that concurrent misses
+  // on a file open it only once.
+  port::Mutex* GetLoaderMutex(uint64_t file_number) {
+    return &loader_mutexes_[file_number % kNumLoaderMutexes];
+  }
+
+  static const size_t kNumLoaderMutexes = 128;
+  port::Mutex loader_mutexes_[kNumLoaderMutexes];
+
   Env* env_;
   EnvOptions env_options_;
   TitanDBOptions db_options_;
   TitanCFOptions cf_options_;
   std::shared_ptr<Cache> cache_;
   TitanStats* stats_;
+  uint32_t blob_cache_id_;
+  // Shared by the readers of this column family to decide the admission
+  // of the blob cache.
+  std::shared_ptr<FrequencySketch> admission_;
 };
 
 }  // namespace titandb
@@ -1,5 +1,7 @@
 #include "blob_file_iterator.h"
 
+#include <algorithm>
+
 #include "table/block_based/block_based_table_reader.h"
 #include "util/crc32c.h"
 
@@ -11,11 +13,14 @@ namespace titandb {
 
 BlobFileIterator::BlobFileIterator(
     std::unique_ptr<RandomAccessFileReader>&& file, uint64_t file_name,
-    uint64_t file_size, const TitanCFOptions& titan_cf_options)
+    uint64_t file_size, const TitanCFOptions& titan_cf_options,
+    uint32_t blob_cache_id, RateLimiter* rate_limiter)
     : file_(std::move(file)),
       file_number_(file_name),
       file_size_(file_size),
-      titan_cf_options_(titan_cf_options) {}
+      titan_cf_options_(titan_cf_options),
+      blob_cache_id_(blob_cache_id),
+      rate_limiter_(rate_limiter) {}
 
 BlobFileIterator::~BlobFileIterator() {}
 
@@ -37,6 +42,12 @@ bool BlobFileIterator::Init() {
   }
 
   header_size_ = blob_file_header.size();
+  if (blob_file_header.flags & BlobFileHeader::kBlobLog) {
+    // A blob log has no meta blocks or footer.
+    end_of_blob_record_ = file_size_;
+    init_ = true;
+    return true;
+  }
 
   char footer_buf[BlobFileFooter::kEncodedLength];
   // With for_compaction=true, rate_limiter is enabled. Since BlobFileIterator
@@ -55,8 +66,11 @@ bool BlobFileIterator::Init() {
   }
 
   if (blob_file_header.flags & BlobFileHeader::kHasUncompressionDictionary) {
-    status_ = InitUncompressionDict(blob_file_footer, file_.get(),
-                                    &uncompression_dict_);
+    status_ = InitUncompressionDict(
+        blob_file_footer, file_.get(), titan_cf_options_.blob_cache.get(),
+        GetUncompressionDictCacheKey(blob_cache_id_, file_number_,
+                                     blob_file_footer),
+        &uncompression_dict_);
     if (!status_.ok()) {
       return false;
     }
@@ -130,25 +144,50 @@ void BlobFileIterator::IterateForPrev(uint64_t offset) {
   valid_ = false;
 }
 
+Status BlobFileIterator::ReadRecordData(uint64_t offset, size_t size,
+                                        Slice* result, char* scratch) {
+  if (!titan_cf_options_.blob_batched_read) {
+    // With for_compaction=true, rate_limiter is enabled. Since
+    // BlobFileIterator is only used for GC, we always set for_compaction to
+    // true.
+    return file_->Read(IOOptions(), offset, size, result, scratch,
+                       nullptr /*aligned_buf*/, true /*for_compaction*/);
+  }
+  if (offset < window_start_ ||
+      offset + size > window_start_ + window_.size()) {
+    // Reads the next window as a batch of requests. A record larger than
+    // the window is read whole.
+    uint64_t window_size = std::max<uint64_t>(
+        size, std::min(kBatchedReadWindowSize, end_of_blob_record_ - offset));
+    window_.resize(static_cast<size_t>(window_size));
+    Status s = BatchedRead(file_.get(), offset, window_.size(),
+                           window_.data(), rate_limiter_);
+    if (!s.ok()) {
+      window_.clear();
+      return s;
+    }
+    window_start_ = offset;
+  }
+  *result = Slice(window_.data() + (offset - window_start_), size);
+  return Status::OK();
+}
+
 void BlobFileIterator::GetBlobRecord() {
   FixedSlice<kRecordHeaderSize> header_buffer;
-  // With for_compaction=true, rate_limiter is enabled. Since BlobFileIterator
-  // is only used for GC, we always set for_compaction to true.
-  status_ = file_->Read(IOOptions(), iterate_offset_, kRecordHeaderSize,
-                        &header_buffer, header_buffer.get(),
-                        nullptr /*aligned_buf*/, true /*for_compaction*/);
+  Slice header_slice;
+  status_ = ReadRecordData(iterate_offset_, kRecordHeaderSize, &header_slice,
+                           header_buffer.get());
   if (!status_.ok()) return;
-  status_ = decoder_.DecodeHeader(&header_buffer);
+  status_ = decoder_.DecodeHeader(&header_slice);
   if (!status_.ok()) return;
 
   Slice record_slice;
   auto record_size = decoder_.GetRecordSize();
-  buffer_.resize(record_size);
-  // With for_compaction=true, rate_limiter is enabled. Since BlobFileIterator
-  // is only used for GC, we always set for_compaction to true.
-  status_ = file_->Read(IOOptions(), iterate_offset_ + kRecordHeaderSize,
-                        record_size, &record_slice, buffer_.data(),
-                        nullptr /*aligned_buf*/, true /*for_compaction*/);
+  if (!titan_cf_options_.blob_batched_read) {
+    buffer_.resize(record_size);
+  }
+  status_ = ReadRecordData(iterate_offset_ + kRecordHeaderSize, record_size,
+                           &record_slice, buffer_.data());
   if (status_.ok()) {
     status_ =
         decoder_.DecodeRecord(&record_slice, &cur_blob_record_, &uncompressed_);
@@ -179,7 +218,9 @@ void BlobFileIterator::PrefetchAndGet() {
   }
   auto min_blob_size =
       iterate_offset_ + kRecordHeaderSize + titan_cf_options_.min_blob_size;
-  if (readahead_end_offset_ <= min_blob_size) {
+  // The batched reads read ahead by themselves.
+  if (!titan_cf_options_.blob_batched_read &&
+      readahead_end_offset_ <= min_blob_size) {
     while (readahead_end_offset_ + readahead_size_ <= min_blob_size &&
            readahead_size_ < kMaxReadaheadSize)
       readahead_size_ <<= 1;
@@ -21,10 +21,17 @@ class BlobFileIterator {
  public:
   const uint64_t kMinReadaheadSize = 4 << 10;
   const uint64_t kMaxReadaheadSize = 256 << 10;
+  // Size of the window read at once with `blob_batched_read`.
+  const uint64_t kBatchedReadWindowSize = 1 << 20;
 
+  // "blob_cache_id" is the cache id of the blob cache keys, used to share
+  // the uncompression dictionary through the blob cache. The batched reads
+  // of `blob_batched_read` are charged to "rate_limiter" if not null.
   BlobFileIterator(std::unique_ptr<RandomAccessFileReader>&& file,
                    uint64_t file_name, uint64_t file_size,
-                   const TitanCFOptions& titan_cf_options);
+                   const TitanCFOptions& titan_cf_options,
+                   uint32_t blob_cache_id = 0,
+                   RateLimiter* rate_limiter = nullptr);
   ~BlobFileIterator();
 
   bool Init();
@@ -53,6 +60,8 @@ class BlobFileIterator {
   const uint64_t file_number_;
   const uint64_t file_size_;
   TitanCFOptions titan_cf_options_;
+  const uint32_t blob_cache_id_;
+  RateLimiter* const rate_limiter_;
 
   bool init_{false};
   uint64_t end_of_blob_record_{0};
@@ -61,7 +70,7 @@ class BlobFileIterator {
   Status status_;
   bool valid_{false};
 
-  std::unique_ptr<UncompressionDict> uncompression_dict_;
+  std::shared_ptr<UncompressionDict> uncompression_dict_;
   BlobDecoder decoder_;
 
   uint64_t iterate_offset_{0};
@@ -78,8 +87,17 @@ class BlobFileIterator {
   uint64_t readahead_end_offset_{0};
   uint64_t readahead_size_{kMinReadaheadSize};
 
+  // With `blob_batched_read`, the records are read from this window, which
+  // holds the file data starting at "window_start_".
+  std::vector<char> window_;
+  uint64_t window_start_{0};
+
   void PrefetchAndGet();
   void GetBlobRecord();
+  // Reads [offset, offset + size) of the records, from the window with
+  // `blob_batched_read`, or from the file into "scratch" otherwise.
+  Status ReadRecordData(uint64_t offset, size_t size, Slice* result,
+                        char* scratch);
 };
 
 class BlobFileMergeIterator {
@@ -3,6 +3,7 @@
 #include <cinttypes>
 
 #include "file/filename.h"
+#include "test_util/sync_point.h"
 #include "test_util/testharness.h"
 #include "util/random.h"
 
@@ -97,13 +98,14 @@ class BlobFileIteratorTest : public testing::Test {
     }
   }
 
-  void NewBlobFileIterator() {
+  void NewBlobFileIterator(
+      const TitanCFOptions& cf_options = TitanCFOptions()) {
     uint64_t file_size = 0;
     ASSERT_OK(env_->GetFileSize(file_name_, &file_size));
     NewBlobFileReader(file_number_, 0, titan_options_, env_options_, env_,
                       &readable_file_);
     blob_file_iterator_.reset(new BlobFileIterator{
-        std::move(readable_file_), file_number_, file_size, TitanCFOptions()});
+        std::move(readable_file_), file_number_, file_size, cf_options});
   }
 
   void TestBlobFileIterator() {
@@ -150,6 +152,45 @@ TEST_F(BlobFileIteratorTest, DictCompress) {
 #endif
 }
 
+TEST_F(BlobFileIteratorTest, DictCompressCached) {
+#if ZSTD_VERSION_NUMBER >= 10103
+  CompressionOptions compression_opts;
+  compression_opts.enabled = true;
+  compression_opts.max_dict_bytes = 4000;
+  titan_options_.blob_file_compression = kZSTD;
+  titan_options_.blob_file_compression_options = compression_opts;
+  titan_options_.blob_cache = NewLRUCache(1 << 20);
+
+  NewBuilder();
+  const int n = 100;
+  BlobFileBuilder::OutContexts contexts;
+  for (int i = 0; i < n; i++) {
+    AddKeyValue(GenKey(i), GenValue(i), contexts);
+  }
+  FinishBuilder(contexts);
+
+  std::atomic<int> num_loads{0};
+  SyncPoint::GetInstance()->SetCallBack("InitUncompressionDict:Load",
+                                        [&](void*) { num_loads++; });
+  SyncPoint::GetInstance()->EnableProcessing();
+
+  // The dictionary is loaded once and shared by the later iterators.
+  for (int round = 0; round < 3; round++) {
+    NewBlobFileIterator(titan_options_);
+    blob_file_iterator_->SeekToFirst();
+    for (int i = 0; i < n; blob_file_iterator_->Next(), i++) {
+      ASSERT_OK(blob_file_iterator_->status());
+      ASSERT_TRUE(blob_file_iterator_->Valid());
+      ASSERT_EQ(GenValue(i), blob_file_iterator_->value());
+    }
+  }
+  ASSERT_EQ(1, num_loads.load());
+
+  SyncPoint::GetInstance()->DisableProcessing();
+  SyncPoint::GetInstance()->ClearAllCallBacks();
+#endif
+}
+
 TEST_F(BlobFileIteratorTest, IterateForPrev) {
   NewBuilder();
   const int n = 1000;
@@ -214,6 +255,35 @@ TEST_F(BlobFileIteratorTest, IterateForPrev) {
   ASSERT_EQ(blob_handle, blob_index.blob_handle);
 }
 
+TEST_F(BlobFileIteratorTest, BatchedRead) {
+  titan_options_.blob_batched_read = true;
+  NewBuilder();
+  const int n = 1000;
+  // A record larger than the read window in the middle.
+  const int big = n / 2;
+  const std::string big_value(3 << 20, 'v');
+  BlobFileBuilder::OutContexts contexts;
+  for (int i = 0; i < n; i++) {
+    AddKeyValue(GenKey(i), i == big ? big_value : GenValue(i), contexts);
+  }
+  FinishBuilder(contexts);
+
+  NewBlobFileIterator(titan_options_);
+  blob_file_iterator_->SeekToFirst();
+  ASSERT_EQ(contexts.size(), n);
+  for (int i = 0; i < n; blob_file_iterator_->Next(), i++) {
+    ASSERT_OK(blob_file_iterator_->status());
+    ASSERT_TRUE(blob_file_iterator_->Valid());
+    ASSERT_EQ(GenKey(i), blob_file_iterator_->key());
+    ASSERT_EQ(i == big ? big_value : GenValue(i),
+              blob_file_iterator_->value());
+    ASSERT_EQ(contexts[i]->new_blob_index.blob_handle,
+              blob_file_iterator_->GetBlobIndex().blob_handle);
+  }
+  ASSERT_OK(blob_file_iterator_->status());
+  ASSERT_FALSE(blob_file_iterator_->Valid());
+}
+
 TEST_F(BlobFileIteratorTest, MergeIterator) {
   const int kMaxKeyNum = 1000;
   BlobFileBuilder::OutContexts contexts;
@@ -4,14 +4,19 @@
 #define __STDC_FORMAT_MACROS
 #endif
 
+#include <algorithm>
 #include <cinttypes>
 
+#include "file/file_util.h"
 #include "file/filename.h"
 #include "file/readahead_raf.h"
+#include "rocksdb/rate_limiter.h"
+#include "rocksdb/system_clock.h"
 #include "table/block_based/block.h"
 #include "table/internal_iterator.h"
 #include "table/meta_blocks.h"
 #include "test_util/sync_point.h"
+#include "util/aligned_buffer.h"
 #include "util/crc32c.h"
 #include "util/string_util.h"
 
@@ -40,26 +45,166 @@ Status NewBlobFileReader(uint64_t file_number, uint64_t readahead_size,
   return s;
 }
 
+namespace {
+
+// Charges "size" bytes of reads to "rate_limiter" if not null, in requests
+// of at most a single burst.
+void RequestReadBytes(RateLimiter* rate_limiter, size_t size) {
+  if (rate_limiter == nullptr ||
+      !rate_limiter->IsRateLimited(RateLimiter::OpType::kRead)) {
+    return;
+  }
+  size_t remaining = size;
+  while (remaining > 0) {
+    size_t bytes = static_cast<size_t>(std::min(
+        static_cast<int64_t>(remaining), rate_limiter->GetSingleBurstBytes()));
+    rate_limiter->Request(bytes, Env::IO_LOW, nullptr /*stats*/,
+                          RateLimiter::OpType::kRead);
+    remaining -= bytes;
+  }
+}
+
+}  // namespace
+
+Status BatchedRead(RandomAccessFileReader* file, uint64_t offset, size_t size,
+                   char* scratch, RateLimiter* rate_limiter,
+                   const IOOptions& io_options, size_t* read_size) {
+  // The bytes of the batch are charged up front, so that the requests
+  // are submitted together.
+  RequestReadBytes(rate_limiter, size);
+
+  std::vector<FSReadRequest> reqs;
+  reqs.reserve((size + kBatchedReadRequestSize - 1) / kBatchedReadRequestSize);
+  for (size_t pos = 0; pos < size; pos += kBatchedReadRequestSize) {
+    FSReadRequest req;
+    req.offset = offset + pos;
+    req.len = std::min(size - pos, kBatchedReadRequestSize);
+    req.scratch = scratch + pos;
+    reqs.emplace_back(std::move(req));
+  }
+  AlignedBuf aligned_buf;
+  Status s = file->MultiRead(io_options, reqs.data(), reqs.size(),
+                             file->use_direct_io() ? &aligned_buf : nullptr);
+  if (!s.ok()) {
+    return s;
+  }
+  size_t total = 0;
+  for (auto& req : reqs) {
+    if (!req.status.ok()) {
+      return req.status;
+    }
+    bool valid = false;
+    if (total < req.offset - offset) {
+      // A previous request ended early at the end of the file.
+      valid = req.result.empty();
+    } else {
+      valid = req.result.size() == req.len ||
+              (read_size != nullptr && req.result.size() < req.len);
+    }
+    if (!valid) {
+      return Status::Corruption(
+          "BatchedRead actual size: " + ToString(req.result.size()) +
+          " not equal to read size " + ToString(req.len));
+    }
+    // The result may point into the aligned buffer of direct I/O.
+    if (req.result.data() != req.scratch) {
+      memcpy(req.scratch, req.result.data(), req.result.size());
+    }
+    total += req.result.size();
+  }
+  if (read_size != nullptr) {
+    *read_size = total;
+  }
+  return Status::OK();
+}
+
 const uint64_t kMaxReadaheadSize = 256 << 10;
+// Records whose gap is not larger than this are merged into one read by
+// MultiGet.
+const uint64_t kMultiGetMaxGapSize = 4 << 10;
+// Max chunks read at once by GetChunks.
+const size_t kMaxParallelChunkReads = 4;
+// A record read with direct I/O is copied out of the aligned buffer unless
+// the padding of the buffer is at most 1/kMaxDirectReadPaddingRatio of the
+// record, so that the blob cache doesn't hold much more than it charges.
+const size_t kMaxDirectReadPaddingRatio = 8;
 
 namespace {
 
-void GenerateCachePrefix(std::string* dst, Cache* cc,
-                         FSRandomAccessFile* file) {
-  char buffer[kMaxVarint64Length * 3 + 1];
-  auto size = file->GetUniqueId(buffer, sizeof(buffer));
-  if (size == 0) {
-    auto end = EncodeVarint64(buffer, cc->NewId());
-    size = end - buffer;
+void ReleaseFileRef(void* arg1, void* /*arg2*/) {
+  delete reinterpret_cast<std::shared_ptr<RandomAccessFileReader>*>(arg1);
+}
+
+void ReleaseWindowRef(void* arg1, void* /*arg2*/) {
+  delete reinterpret_cast<std::shared_ptr<std::string>*>(arg1);
+}
+
+// Blob cache values are BlobCacheValue. They are saved to and created
+// from the secondary cache of the blob cache as the compression type
+// followed by the data.
+size_t BlobCacheSize(void* obj) {
+  return 1 + reinterpret_cast<BlobCacheValue*>(obj)->data.size();
+}
+
+Status BlobCacheSaveTo(void* from_obj, size_t from_offset, size_t length,
+                       void* out) {
+  auto value = reinterpret_cast<BlobCacheValue*>(from_obj);
+  char* dst = reinterpret_cast<char*>(out);
+  if (from_offset == 0 && length > 0) {
+    *dst++ = static_cast<char>(value->compression);
+    from_offset++;
+    length--;
   }
-  dst->assign(buffer, size);
+  memcpy(dst, value->data.data() + from_offset - 1, length);
+  return Status::OK();
 }
 
-void EncodeBlobCache(std::string* dst, const Slice& prefix, uint64_t offset) {
-  dst->assign(prefix.data(), prefix.size());
-  PutVarint64(dst, offset);
+Status BlobCacheCreate(void* buf, size_t size, void** out_obj,
+                       size_t* charge) {
+  if (size < 1) {
+    return Status::Corruption("blob cache value too short");
+  }
+  const char* src = reinterpret_cast<const char*>(buf);
+  CacheAllocationPtr data(new char[size - 1]);
+  memcpy(data.get(), src + 1, size - 1);
+  auto value = new BlobCacheValue;
+  value->compression = static_cast<CompressionType>(src[0]);
+  value->data.reset(std::move(data), size - 1);
+  *out_obj = value;
+  *charge = size - 1 + sizeof(*value);
+  return Status::OK();
+}
+
+const Cache::CacheItemHelper* BlobCacheItemHelper() {
+  static Cache::CacheItemHelper helper(BlobCacheSize, BlobCacheSaveTo,
+                                       DeleteCacheValue<BlobCacheValue>);
+  return &helper;
+}
+
+}  // namespace
+
+bool IsBlobCached(Cache* cache, const BlobCacheKey& cache_key) {
+  Cache::Handle* cache_handle = cache->Lookup(cache_key.AsSlice());
+  if (cache_handle == nullptr) {
+    return false;
+  }
+  cache->Release(cache_handle);
+  return true;
 }
 
+void InsertBlobCache(Cache* cache, const BlobCacheKey& cache_key,
+                     const Slice& encoded_record) {
+  CacheAllocationPtr data(new char[encoded_record.size()]);
+  memcpy(data.get(), encoded_record.data(), encoded_record.size());
+  auto cache_value = new BlobCacheValue;
+  cache_value->data.reset(std::move(data), encoded_record.size());
+  auto cache_size = cache_value->data.size() + sizeof(*cache_value);
+  cache->Insert(cache_key.AsSlice(), cache_value, BlobCacheItemHelper(),
+                cache_size);
+}
+
+namespace {
+
 // Seek to the specified meta block.
 // Return true if it successfully seeks to that block.
 Status SeekToMetaBlock(InternalIterator* meta_iter,
@@ -85,18 +230,29 @@ Status SeekToMetaBlock(InternalIterator* meta_iter,
 
 Status BlobFileReader::Open(const TitanCFOptions& options,
                             std::unique_ptr<RandomAccessFileReader> file,
-                            uint64_t file_size,
+                            uint64_t file_number, uint64_t file_size,
                             std::unique_ptr<BlobFileReader>* result,
-                            TitanStats* stats) {
-  if (file_size < BlobFileFooter::kEncodedLength) {
-    return Status::Corruption("file is too short to be a blob file");
-  }
-
+                            TitanStats* stats, SystemClock* clock,
+                            uint32_t blob_cache_id,
+                            std::shared_ptr<FrequencySketch> admission) {
   BlobFileHeader header;
   Status s = ReadHeader(file, &header);
   if (!s.ok()) {
     return s;
   }
+  if (header.flags & BlobFileHeader::kBlobLog) {
+    // A blob log has no footer, and may still be written. Its records are
+    // read by their handles only.
+    // Its size is not known, as it may still grow.
+    result->reset(new BlobFileReader(options, std::move(file), file_number,
+                                     port::kMaxUint64 /*file_size*/,
+                                     blob_cache_id, std::move(admission),
+                                     stats, clock));
+    return Status::OK();
+  }
+  if (file_size < BlobFileFooter::kEncodedLength) {
+    return Status::Corruption("file is too short to be a blob file");
+  }
 
   FixedSlice<BlobFileFooter::kEncodedLength> buffer;
   s = file->Read(IOOptions(), file_size - BlobFileFooter::kEncodedLength,
@@ -106,17 +262,26 @@ Status BlobFileReader::Open(const TitanCFOptions& options,
     return s;
   }
 
+  // The file returns its own memory instead of filling the scratch buffer
+  // when it is memory mapped.
+  bool mmap_reads = buffer.data() != buffer.get();
+
   BlobFileFooter footer;
   s = DecodeInto(buffer, &footer);
   if (!s.ok()) {
     return s;
   }
 
-  auto reader = new BlobFileReader(options, std::move(file), stats);
+  auto reader =
+      new BlobFileReader(options, std::move(file), file_number, file_size,
+                         blob_cache_id, std::move(admission), stats, clock);
   reader->footer_ = footer;
+  reader->mmap_reads_ = mmap_reads;
   if (header.flags & BlobFileHeader::kHasUncompressionDictionary) {
-    s = InitUncompressionDict(footer, reader->file_.get(),
-                              &reader->uncompression_dict_);
+    s = InitUncompressionDict(
+        footer, reader->file_.get(), reader->cache_.get(),
+        GetUncompressionDictCacheKey(blob_cache_id, file_number, footer),
+        &reader->uncompression_dict_);
     if (!s.ok()) {
       return s;
     }
@@ -139,61 +304,625 @@ Status BlobFileReader::ReadHeader(std::unique_ptr<RandomAccessFileReader>& file,
 
 BlobFileReader::BlobFileReader(const TitanCFOptions& options,
                                std::unique_ptr<RandomAccessFileReader> file,
-                               TitanStats* stats)
+                               uint64_t file_number, uint64_t file_size,
+                               uint32_t blob_cache_id,
+                               std::shared_ptr<FrequencySketch> admission,
+                               TitanStats* stats, SystemClock* clock)
     : options_(options),
       file_(std::move(file)),
+      file_number_(file_number),
+      file_size_(file_size),
       cache_(options.blob_cache),
-      stats_(stats) {
-  if (cache_) {
-    GenerateCachePrefix(&cache_prefix_, cache_.get(), file_->file());
-  }
+      blob_cache_id_(blob_cache_id),
+      admission_(std::move(admission)),
+      stats_(stats),
+      clock_(clock) {}
+
+Status BlobFileReader::PrepareIOOptions(const ReadOptions& options,
+                                        IOOptions* io_options) const {
+  return PrepareIOFromReadOptions(options, clock_, *io_options);
 }
 
-Status BlobFileReader::Get(const ReadOptions& /*options*/,
+Status BlobFileReader::Get(const ReadOptions& options,
                            const BlobHandle& handle, BlobRecord* record,
                            PinnableSlice* buffer) {
   TEST_SYNC_POINT("BlobFileReader::Get");
+  return GetImpl(options, handle, record, buffer, nullptr /*window*/,
+                 0 /*window_offset*/);
+}
 
-  std::string cache_key;
+Status BlobFileReader::GetImpl(const ReadOptions& options,
+                               const BlobHandle& handle, BlobRecord* record,
+                               PinnableSlice* buffer,
+                               const std::shared_ptr<std::string>* window,
+                               size_t window_offset) {
+  BlobCacheKey cache_key = GetCacheKey(handle.offset);
+  bool fill_cache = ShouldFillCache(options, cache_key.AsSlice());
   Cache::Handle* cache_handle = nullptr;
   if (cache_) {
-    EncodeBlobCache(&cache_key, cache_prefix_, handle.offset);
-    cache_handle = cache_->Lookup(cache_key);
+    cache_handle = LookupBlob(cache_key.AsSlice());
     if (cache_handle) {
       RecordTick(statistics(stats_), TITAN_BLOB_CACHE_HIT);
-      auto blob = reinterpret_cast<OwnedSlice*>(cache_->Value(cache_handle));
-      buffer->PinSlice(*blob, UnrefCacheHandle, cache_.get(), cache_handle);
-      return DecodeInto(*blob, record);
+      return PinCachedBlob(cache_handle, record, buffer);
     }
   }
   RecordTick(statistics(stats_), TITAN_BLOB_CACHE_MISS);
+  if (cache_ && options.fill_cache && !fill_cache) {
+    RecordTick(statistics(stats_), TITAN_BLOB_CACHE_ADMISSION_REJECT);
+  }
 
   OwnedSlice blob;
-  Status s = ReadRecord(handle, record, &blob);
+  BlobCacheValue compressed;
+  Status s;
+  if (window != nullptr) {
+    Slice data((*window)->data() + window_offset, handle.size);
+    s = DecodeRecord(data, nullptr /*ubuf*/, record, &blob,
+                     CompressedCacheValue(fill_cache, &compressed));
+  } else {
+    IOOptions io_options;
+    s = PrepareIOOptions(options, &io_options);
+    if (s.ok()) {
+      s = ReadRecord(io_options, handle, record, &blob,
+                     CompressedCacheValue(fill_cache, &compressed));
+    }
+  }
   if (!s.ok()) {
     return s;
   }
+  if (!blob.owns_data() && window != nullptr) {
+    // The uncompressed record points into the window.
+    if (!fill_cache) {
+      Slice pinned = blob;
+      buffer->PinSlice(pinned, ReleaseWindowRef,
+                       new std::shared_ptr<std::string>(*window), nullptr);
+      return Status::OK();
+    }
+    // Copied to be owned by the blob cache, with the record pointing into
+    // the copy.
+    CacheAllocationPtr ubuf(new char[blob.size()]);
+    memcpy(ubuf.get(), blob.data(), blob.size());
+    const char* base = blob.data();
+    record->key = Slice(ubuf.get() + (record->key.data() - base),
+                        record->key.size());
+    record->value = Slice(ubuf.get() + (record->value.data() - base),
+                          record->value.size());
+    Slice owned(ubuf.get(), blob.size());
+    blob.reset(std::move(ubuf), owned);
+  }
+  if (!blob.owns_data()) {
+    // The record points into the file mapping. It is not inserted into the
+    // blob cache, and the pin keeps the mapping alive.
+    assert(mmap_reads_);
+    Slice pinned = blob;
+    buffer->PinSlice(pinned, ReleaseFileRef,
+                     new std::shared_ptr<RandomAccessFileReader>(file_),
+                     nullptr);
+    return Status::OK();
+  }
+  PinBlob(cache_key.AsSlice(), &blob, &compressed, fill_cache, buffer);
+  return Status::OK();
+}
+
+void BlobFileReader::MultiGet(const ReadOptions& options,
+                              std::vector<BlobReadRequest>* requests) {
+  TEST_SYNC_POINT("BlobFileReader::MultiGet");
+
+  std::sort(requests->begin(), requests->end(),
+            [](const BlobReadRequest& a, const BlobReadRequest& b) {
+              return a.handle.offset < b.handle.offset;
+            });
+
+  std::vector<BlobReadRequest*> misses;
+  std::vector<BlobCacheKey> cache_keys;
+  std::vector<bool> fill_caches;
+  for (auto& request : *requests) {
+    BlobCacheKey cache_key = GetCacheKey(request.handle.offset);
+    bool fill_cache = ShouldFillCache(options, cache_key.AsSlice());
+    if (cache_) {
+      auto cache_handle = LookupBlob(cache_key.AsSlice());
+      if (cache_handle) {
+        RecordTick(statistics(stats_), TITAN_BLOB_CACHE_HIT);
+        *request.status =
+            PinCachedBlob(cache_handle, request.record, request.buffer);
+        continue;
+      }
+    }
+    RecordTick(statistics(stats_), TITAN_BLOB_CACHE_MISS);
+    if (cache_ && options.fill_cache && !fill_cache) {
+      RecordTick(statistics(stats_), TITAN_BLOB_CACHE_ADMISSION_REJECT);
+    }
+    misses.push_back(&request);
+    cache_keys.push_back(cache_key);
+    fill_caches.push_back(fill_cache);
+  }
+  if (misses.empty()) {
+    return;
+  }
+
+  // Merges neighbouring records into one read request. "spans" records the
+  // range of misses served by each read request.
+  std::vector<FSReadRequest> read_reqs;
+  std::vector<std::pair<size_t, size_t>> spans;
+  std::vector<CacheAllocationPtr> scratches;
+  for (size_t i = 0; i < misses.size();) {
+    uint64_t start = misses[i]->handle.offset;
+    uint64_t end = start + misses[i]->handle.size;
+    size_t j = i + 1;
+    for (; j < misses.size(); j++) {
+      const BlobHandle& handle = misses[j]->handle;
+      if (handle.offset > end + kMultiGetMaxGapSize ||
+          handle.offset + handle.size - start > kMaxReadaheadSize) {
+        break;
+      }
+      end = std::max(end, handle.offset + handle.size);
+    }
+    FSReadRequest req;
+    req.offset = start;
+    req.len = end - start;
+    scratches.emplace_back(new char[req.len]);
+    req.scratch = scratches.back().get();
+    read_reqs.emplace_back(std::move(req));
+    spans.emplace_back(i, j);
+    i = j;
+  }
+
+  IOOptions io_options;
+  Status s = PrepareIOOptions(options, &io_options);
+  AlignedBuf aligned_buf;
+  if (s.ok()) {
+    s = file_->MultiRead(io_options, read_reqs.data(), read_reqs.size(),
+                         &aligned_buf);
+  }
+  for (size_t k = 0; k < read_reqs.size(); k++) {
+    const FSReadRequest& req = read_reqs[k];
+    Status rs = s.ok() ? Status(req.status) : s;
+    if (rs.ok() && req.result.size() != req.len) {
+      rs = Status::Corruption("MultiRead actual size: " +
+                              ToString(req.result.size()) +
+                              " not equal to read size " + ToString(req.len));
+    }
+    for (size_t i = spans[k].first; i < spans[k].second; i++) {
+      BlobReadRequest* request = misses[i];
+      if (!rs.ok()) {
+        *request->status = rs;
+        continue;
+      }
+      const BlobHandle& handle = request->handle;
+      Slice blob(req.result.data() + (handle.offset - req.offset),
+                 handle.size);
+      CacheAllocationPtr ubuf;
+      if (spans[k].second - spans[k].first == 1 &&
+          blob.data() == scratches[k].get() && blob.size() == req.len) {
+        // The read request serves exactly this record, so take over the
+        // scratch buffer without copying.
+        ubuf = std::move(scratches[k]);
+      } else {
+        ubuf.reset(new char[handle.size]);
+        memcpy(ubuf.get(), blob.data(), handle.size);
+        blob = Slice(ubuf.get(), handle.size);
+      }
+      OwnedSlice owned;
+      BlobCacheValue compressed;
+      *request->status =
+          DecodeRecord(blob, std::move(ubuf), request->record, &owned,
+                       CompressedCacheValue(fill_caches[i], &compressed));
+      if (request->status->ok()) {
+        PinBlob(cache_keys[i].AsSlice(), &owned, &compressed, fill_caches[i],
+                request->buffer);
+      }
+    }
+  }
+}
+
+Status BlobFileReader::GetRange(const ReadOptions& options,
+                                const BlobHandle& handle, const Slice& key,
+                                uint64_t offset, uint64_t length,
+                                PinnableSlice* value) {
+  TEST_SYNC_POINT("BlobFileReader::GetRange");
+
+  auto copy_range = [&](const Slice& full) {
+    if (offset >= full.size()) {
+      value->PinSelf(Slice());
+    } else {
+      value->PinSelf(Slice(full.data() + offset,
+                           std::min<uint64_t>(length, full.size() - offset)));
+    }
+  };
+  BlobRecord record;
+  PinnableSlice buffer;
+  if (cache_) {
+    BlobCacheKey cache_key = GetCacheKey(handle.offset);
+    auto cache_handle = LookupBlob(cache_key.AsSlice());
+    if (cache_handle) {
+      RecordTick(statistics(stats_), TITAN_BLOB_CACHE_HIT);
+      Status s = PinCachedBlob(cache_handle, &record, &buffer);
+      if (s.ok()) {
+        copy_range(record.value);
+      }
+      return s;
+    }
+  }
+
+  // The value starts after the header, the key and two length prefixes.
+  uint64_t range_end = kRecordHeaderSize + 2 * kMaxVarint32Length +
+                       key.size() + std::min(offset, handle.size) +
+                       std::min(length, handle.size);
+  if (range_end >= handle.size) {
+    Status s = Get(options, handle, &record, &buffer);
+    if (s.ok()) {
+      copy_range(record.value);
+    }
+    return s;
+  }
+  RecordTick(statistics(stats_), TITAN_BLOB_CACHE_MISS);
+
+  IOOptions io_options;
+  Status s = PrepareIOOptions(options, &io_options);
+  if (!s.ok()) {
+    return s;
+  }
+  Slice blob;
+  CacheAllocationPtr ubuf(new char[range_end]);
+  s = file_->Read(io_options, handle.offset, range_end, &blob, ubuf.get(),
+                  nullptr /*aligned_buf*/);
+  if (!s.ok()) {
+    return s;
+  }
+  if (blob.size() != range_end) {
+    return Status::Corruption("ReadRecord actual size: " +
+                              ToString(blob.size()) +
+                              " not equal to blob size " + ToString(range_end));
+  }
+  BlobDecoder decoder;
+  s = decoder.DecodeHeader(&blob);
+  if (!s.ok()) {
+    return s;
+  }
+  if (decoder.GetCompression() != kNoCompression) {
+    // The range can't be located without uncompressing the whole record.
+    s = Get(options, handle, &record, &buffer);
+    if (s.ok()) {
+      copy_range(record.value);
+    }
+    return s;
+  }
+  Slice record_key;
+  uint32_t value_size = 0;
+  if (!GetLengthPrefixedSlice(&blob, &record_key) ||
+      !GetVarint32(&blob, &value_size)) {
+    return Status::Corruption("BlobRecord");
+  }
+  if (record_key != key) {
+    return Status::Corruption("BlobRecord", "key mismatch");
+  }
+  if (offset >= value_size) {
+    value->PinSelf(Slice());
+    return s;
+  }
+  uint64_t n = std::min<uint64_t>(length, value_size - offset);
+  if (offset + n > blob.size()) {
+    return Status::Corruption("BlobRecord", "value size mismatch");
+  }
+  value->PinSelf(Slice(blob.data() + offset, n));
+  return s;
+}
 
+Status BlobFileReader::GetChunks(
+    const ReadOptions& options, const BlobHandle& handle, const Slice& key,
+    size_t chunk_size, const std::function<bool(const Slice&)>& callback) {
+  TEST_SYNC_POINT("BlobFileReader::GetChunks");
+  assert(chunk_size > 0);
+
+  // Delivers "data" in pieces of at most "chunk_size" bytes. Returns false
+  // if the callback stops the read.
+  auto deliver = [&](const Slice& data) {
+    for (size_t pos = 0; pos < data.size(); pos += chunk_size) {
+      size_t n = std::min(chunk_size, data.size() - pos);
+      if (!callback(Slice(data.data() + pos, n))) return false;
+    }
+    return true;
+  };
+  // Reads a record not in chunks whole, and verifies it before delivering.
+  auto get_whole = [&]() {
+    BlobRecord record;
+    PinnableSlice buffer;
+    Status s = Get(options, handle, &record, &buffer);
+    if (s.ok()) {
+      deliver(record.value);
+    }
+    return s;
+  };
   if (cache_) {
-    auto cache_value = new OwnedSlice(std::move(blob));
-    auto cache_size = cache_value->size() + sizeof(*cache_value);
-    cache_->Insert(cache_key, cache_value, cache_size,
-                   &DeleteCacheValue<OwnedSlice>, &cache_handle);
-    buffer->PinSlice(*cache_value, UnrefCacheHandle, cache_.get(),
+    BlobCacheKey cache_key = GetCacheKey(handle.offset);
+    auto cache_handle = LookupBlob(cache_key.AsSlice());
+    if (cache_handle) {
+      RecordTick(statistics(stats_), TITAN_BLOB_CACHE_HIT);
+      BlobRecord record;
+      PinnableSlice buffer;
+      Status s = PinCachedBlob(cache_handle, &record, &buffer);
+      if (s.ok()) {
+        deliver(record.value);
+      }
+      return s;
+    }
+  }
+
+  // Reads the prefix of the record up to the start of the value.
+  uint64_t prefix_size =
+      kRecordHeaderSize + 2 * kMaxVarint32Length + key.size();
+  if (handle.size <= prefix_size) {
+    return get_whole();
+  }
+  IOOptions io_options;
+  Status s = PrepareIOOptions(options, &io_options);
+  if (!s.ok()) {
+    return s;
+  }
+  Slice prefix;
+  CacheAllocationPtr prefix_buf(new char[prefix_size]);
+  s = file_->Read(io_options, handle.offset, prefix_size, &prefix,
+                  prefix_buf.get(), nullptr /*aligned_buf*/);
+  if (!s.ok()) {
+    return s;
+  }
+  if (prefix.size() != prefix_size) {
+    return Status::Corruption(
+        "ReadRecord actual size: " + ToString(prefix.size()) +
+        " not equal to blob size " + ToString(prefix_size));
+  }
+  BlobDecoder decoder;
+  s = decoder.DecodeHeader(&prefix);
+  if (!s.ok()) {
+    return s;
+  }
+  if (decoder.GetCompression() != kNoCompression) {
+    // A record in chunks is never compressed.
+    return get_whole();
+  }
+  if (kRecordHeaderSize + decoder.GetRecordSize() != handle.size) {
+    return Status::Corruption("BlobRecord", "record size mismatch");
+  }
+  const char* record_start = prefix.data();
+  Slice record_key;
+  uint32_t value_size = 0;
+  if (!GetLengthPrefixedSlice(&prefix, &record_key) ||
+      !GetVarint32(&prefix, &value_size)) {
+    return Status::Corruption("BlobRecord");
+  }
+  if (record_key != key) {
+    return Status::Corruption("BlobRecord", "key mismatch");
+  }
+  uint64_t value_start = kRecordHeaderSize + (prefix.data() - record_start);
+  uint64_t value_end = value_start + value_size;
+  if (value_end > handle.size) {
+    return Status::Corruption("BlobRecord", "value size mismatch");
+  }
+  if (value_end == handle.size) {
+    // The value is not in chunks.
+    return get_whole();
+  }
+  RecordTick(statistics(stats_), TITAN_BLOB_CACHE_MISS);
+
+  // Reads the checksums of the chunks, which follow the value.
+  size_t checksums_size = static_cast<size_t>(handle.size - value_end);
+  Slice checksums;
+  CacheAllocationPtr checksums_buf(new char[checksums_size]);
+  s = file_->Read(io_options, handle.offset + value_end, checksums_size,
+                  &checksums, checksums_buf.get(), nullptr /*aligned_buf*/);
+  if (!s.ok()) {
+    return s;
+  }
+  if (checksums.size() != checksums_size) {
+    return Status::Corruption(
+        "ReadRecord actual size: " + ToString(checksums.size()) +
+        " not equal to checksums size " + ToString(checksums_size));
+  }
+  BlobValueChunks chunks;
+  s = chunks.DecodeFrom(&checksums, value_size);
+  if (!s.ok()) {
+    return s;
+  }
+  if (!checksums.empty()) {
+    return Status::Corruption("BlobRecord", "redundant chunk checksums");
+  }
+
+  // Reads up to kMaxParallelChunkReads chunks at once into a buffer reused
+  // for the whole value. Each chunk is verified and delivered as soon as
+  // its batch is read, and the next batch is read ahead meanwhile.
+  uint64_t batch_size = std::min<uint64_t>(
+      value_size, kMaxParallelChunkReads * uint64_t{chunks.chunk_size});
+  TEST_SYNC_POINT_CALLBACK("BlobFileReader::GetChunks:BatchSize",
+                           &batch_size);
+  CacheAllocationPtr scratch(new char[batch_size]);
+  bool direct_io = file_->use_direct_io();
+  size_t index = 0;
+  for (uint64_t pos = 0; pos < value_size;) {
+    std::vector<FSReadRequest> reqs;
+    for (size_t i = 0; i < kMaxParallelChunkReads && pos < value_size; i++) {
+      FSReadRequest req;
+      req.offset = handle.offset + value_start + pos;
+      req.len = std::min<uint64_t>(chunks.chunk_size, value_size - pos);
+      req.scratch = scratch.get() + i * chunks.chunk_size;
+      pos += req.len;
+      reqs.emplace_back(std::move(req));
+    }
+    // The deadline is checked again for every batch of a long value.
+    s = PrepareIOOptions(options, &io_options);
+    if (!s.ok()) {
+      return s;
+    }
+    AlignedBuf aligned_buf;
+    s = file_->MultiRead(io_options, reqs.data(), reqs.size(),
+                         direct_io ? &aligned_buf : nullptr);
+    if (!s.ok()) {
+      return s;
+    }
+    if (pos < value_size && !direct_io && !mmap_reads_) {
+      // Lets the file system read the next batch while this one is
+      // delivered.
+      file_->Prefetch(handle.offset + value_start + pos,
+                      static_cast<size_t>(
+                          std::min<uint64_t>(batch_size, value_size - pos)))
+          .PermitUncheckedError();
+    }
+    for (auto& req : reqs) {
+      if (!req.status.ok()) {
+        return req.status;
+      }
+      if (req.result.size() != req.len) {
+        return Status::Corruption("MultiRead actual size: " +
+                                  ToString(req.result.size()) +
+                                  " not equal to read size " +
+                                  ToString(req.len));
+      }
+      if (!chunks.Verify(index++, req.result)) {
+        return Status::Corruption("BlobRecord", "chunk checksum mismatch");
+      }
+      if (!deliver(req.result)) {
+        return s;
+      }
+    }
+  }
+  return s;
+}
+
+Status BlobFileReader::LoadIntoCache(uint64_t offset,
+                                     RateLimiter* rate_limiter) {
+  BlobCacheKey cache_key = GetCacheKey(offset);
+  if (!cache_ || mmap_reads_ || IsBlobCached(cache_.get(), cache_key)) {
+    return Status::OK();
+  }
+  FixedSlice<kRecordHeaderSize> header_buffer;
+  Status s = file_->Read(IOOptions(), offset, kRecordHeaderSize,
+                         &header_buffer, header_buffer.get(),
+                         nullptr /*aligned_buf*/);
+  if (!s.ok()) {
+    return s;
+  }
+  BlobDecoder decoder;
+  s = decoder.DecodeHeader(&header_buffer);
+  if (!s.ok()) {
+    return s;
+  }
+  BlobHandle handle;
+  handle.offset = offset;
+  handle.size = kRecordHeaderSize + decoder.GetRecordSize();
+  // The records are followed by the meta blocks. It bounds the size read
+  // from a stale or wrong offset, whose checksum fails later.
+  if (handle.offset + handle.size > footer_.meta_index_handle.offset()) {
+    return Status::Corruption("LoadIntoCache offset " + ToString(offset) +
+                              " is not a record");
+  }
+  RequestReadBytes(rate_limiter, handle.size);
+
+  BlobRecord record;
+  OwnedSlice blob;
+  BlobCacheValue compressed;
+  s = ReadRecord(IOOptions(), handle, &record, &blob,
+                 CompressedCacheValue(true /*fill_cache*/, &compressed));
+  if (!s.ok()) {
+    return s;
+  }
+  PinnableSlice buffer;
+  PinBlob(cache_key.AsSlice(), &blob, &compressed, true /*fill_cache*/,
+          &buffer);
+  return s;
+}
+
+Cache::Handle* BlobFileReader::LookupBlob(const Slice& cache_key) {
+  return cache_->Lookup(cache_key, BlobCacheItemHelper(), BlobCacheCreate,
+                        Cache::Priority::LOW, true /*wait*/,
+                        statistics(stats_));
+}
+
+Status BlobFileReader::PinCachedBlob(Cache::Handle* cache_handle,
+                                     BlobRecord* record,
+                                     PinnableSlice* buffer) {
+  auto value = reinterpret_cast<BlobCacheValue*>(cache_->Value(cache_handle));
+  if (value->compression == kNoCompression) {
+    buffer->PinSlice(value->data, UnrefCacheHandle, cache_.get(),
                      cache_handle);
-  } else {
-    buffer->PinSlice(blob, OwnedSlice::CleanupFunc, blob.release(), nullptr);
+    return DecodeInto(value->data, record);
+  }
+  UncompressionContext ctx(value->compression);
+  UncompressionInfo info(ctx,
+                         uncompression_dict_ == nullptr
+                             ? UncompressionDict::GetEmptyDict()
+                             : *uncompression_dict_,
+                         value->compression);
+  OwnedSlice blob;
+  Status s = Uncompress(info, value->data, &blob);
+  cache_->Release(cache_handle);
+  if (!s.ok()) {
+    return s;
+  }
+  s = DecodeInto(blob, record);
+  if (!s.ok()) {
+    return s;
   }
+  Slice pinned = blob;
+  buffer->PinSlice(pinned, OwnedSlice::CleanupFunc, blob.release(), nullptr);
+  return s;
+}
 
-  return Status::OK();
+bool BlobFileReader::ShouldFillCache(const ReadOptions& options,
+                                     const Slice& cache_key) {
+  if (!cache_ || !options.fill_cache) {
+    return false;
+  }
+  // Every read that may fill the cache is counted, including the hits.
+  return admission_ == nullptr ||
+         admission_->Increment(cache_key) >=
+             options_.blob_cache_admission_frequency;
 }
 
-Status BlobFileReader::ReadRecord(const BlobHandle& handle, BlobRecord* record,
-                                  OwnedSlice* buffer) {
+void BlobFileReader::PinBlob(const Slice& cache_key, OwnedSlice* blob,
+                             BlobCacheValue* compressed, bool fill_cache,
+                             PinnableSlice* buffer) {
+  if (fill_cache && compressed->compression != kNoCompression &&
+      blob->size() >=
+          options_.blob_cache_compressed_ratio * compressed->data.size()) {
+    // Caches the compressed form, and pins the uncompressed blob to the
+    // buffer only.
+    auto cache_value = new BlobCacheValue(std::move(*compressed));
+    auto cache_size = cache_value->data.size() + sizeof(*cache_value);
+    cache_->Insert(cache_key, cache_value, BlobCacheItemHelper(), cache_size);
+    Slice pinned = *blob;
+    buffer->PinSlice(pinned, OwnedSlice::CleanupFunc, blob->release(),
+                     nullptr);
+  } else if (fill_cache) {
+    Cache::Handle* cache_handle = nullptr;
+    auto cache_value = new BlobCacheValue;
+    cache_value->data = std::move(*blob);
+    auto cache_size = cache_value->data.size() + sizeof(*cache_value);
+    cache_->Insert(cache_key, cache_value, BlobCacheItemHelper(), cache_size,
+                   &cache_handle);
+    buffer->PinSlice(cache_value->data, UnrefCacheHandle, cache_.get(),
+                     cache_handle);
+  } else {
+    Slice pinned = *blob;
+    buffer->PinSlice(pinned, OwnedSlice::CleanupFunc, blob->release(),
+                     nullptr);
+  }
+}
+
+Status BlobFileReader::ReadRecord(const IOOptions& io_options,
+                                  const BlobHandle& handle, BlobRecord* record,
+                                  OwnedSlice* buffer,
+                                  BlobCacheValue* compressed) {
   Slice blob;
-  CacheAllocationPtr ubuf(new char[handle.size]);
-  Status s = file_->Read(IOOptions(), handle.offset, handle.size, &blob,
-                         ubuf.get(), nullptr /*aligned_buf*/);
+  CacheAllocationPtr ubuf;
+  AlignedBuf aligned_buf;
+  // A memory mapped file doesn't need a scratch buffer. With direct I/O,
+  // the aligned buffer read into is taken over if the record fills most of
+  // it. Otherwise the scratch buffer is allocated per read, because it is
+  // handed over to the returned record or the blob cache.
+  bool direct_io = file_->use_direct_io();
+  if (!mmap_reads_ && !direct_io) {
+    ubuf.reset(new char[handle.size]);
+  }
+  Status s = file_->Read(io_options, handle.offset, handle.size, &blob,
+                         ubuf.get(), direct_io ? &aligned_buf : nullptr);
   if (!s.ok()) {
     return s;
   }
@@ -202,15 +931,47 @@ Status BlobFileReader::ReadRecord(const BlobHandle& handle, BlobRecord* record,
         "ReadRecord actual size: " + ToString(blob.size()) +
         " not equal to blob size " + ToString(handle.size));
   }
+  if (aligned_buf) {
+    // RandomAccessFileReader reads the whole pages around the record, into
+    // a buffer with one more page to align it.
+    size_t alignment = file_->file()->GetRequiredBufferAlignment();
+    size_t offset = static_cast<size_t>(handle.offset);
+    size_t capacity = Roundup(offset + blob.size(), alignment) -
+                      TruncateToPageBoundary(alignment, offset) + alignment;
+    if (capacity - blob.size() <= blob.size() / kMaxDirectReadPaddingRatio) {
+      ubuf.reset(aligned_buf.release());
+    } else {
+      ubuf.reset(new char[blob.size()]);
+      memcpy(ubuf.get(), blob.data(), blob.size());
+      blob = Slice(ubuf.get(), blob.size());
+    }
+  }
+  return DecodeRecord(blob, std::move(ubuf), record, buffer, compressed);
+}
 
+Status BlobFileReader::DecodeRecord(Slice blob, CacheAllocationPtr ubuf,
+                                    BlobRecord* record, OwnedSlice* buffer,
+                                    BlobCacheValue* compressed) {
   BlobDecoder decoder(uncompression_dict_ == nullptr
                           ? &UncompressionDict::GetEmptyDict()
                           : uncompression_dict_.get());
-  s = decoder.DecodeHeader(&blob);
+  Status s = decoder.DecodeHeader(&blob);
   if (!s.ok()) {
     return s;
   }
-  buffer->reset(std::move(ubuf), blob);
+  if (compressed && decoder.GetCompression() != kNoCompression) {
+    // Keeps the compressed form, "buffer" is filled with the uncompressed
+    // data below.
+    if (!ubuf) {
+      ubuf.reset(new char[blob.size()]);
+      memcpy(ubuf.get(), blob.data(), blob.size());
+      blob = Slice(ubuf.get(), blob.size());
+    }
+    compressed->data.reset(std::move(ubuf), blob);
+    compressed->compression = decoder.GetCompression();
+  } else {
+    buffer->reset(std::move(ubuf), blob);
+  }
   s = decoder.DecodeRecord(&blob, record, buffer);
   return s;
 }
@@ -218,30 +979,113 @@ Status BlobFileReader::ReadRecord(const BlobHandle& handle, BlobRecord* record,
 Status BlobFilePrefetcher::Get(const ReadOptions& options,
                                const BlobHandle& handle, BlobRecord* record,
                                PinnableSlice* buffer) {
-  if (handle.offset == last_offset_) {
-    last_offset_ = handle.offset + handle.size;
-    if (handle.offset + handle.size > readahead_limit_) {
+  // The readahead is bounded by the deadline of the read as well.
+  IOOptions io_options;
+  Status s = reader_->PrepareIOOptions(options, &io_options);
+  if (!s.ok()) {
+    return s;
+  }
+  uint64_t start = handle.offset;
+  uint64_t end = handle.offset + handle.size;
+  if (start == last_offset_) {
+    if (end > readahead_limit_) {
       readahead_size_ = std::max(handle.size, readahead_size_);
-      reader_->file_->Prefetch(handle.offset, readahead_size_);
-      readahead_limit_ = handle.offset + readahead_size_;
+      Prefetch(start, readahead_size_, io_options);
+      readahead_limit_ = start + readahead_size_;
+      readahead_size_ = std::min(kMaxReadaheadSize, readahead_size_ * 2);
+    }
+  } else if (end == last_start_) {
+    // Reads backward, so reads ahead the range ending at this record.
+    if (start < readahead_start_) {
+      readahead_size_ = std::max(handle.size, readahead_size_);
+      readahead_start_ = end > readahead_size_ ? end - readahead_size_ : 0;
+      Prefetch(readahead_start_, end - readahead_start_, io_options);
       readahead_size_ = std::min(kMaxReadaheadSize, readahead_size_ * 2);
     }
   } else {
-    last_offset_ = handle.offset + handle.size;
     readahead_size_ = 0;
     readahead_limit_ = 0;
+    readahead_start_ = port::kMaxUint64;
   }
+  last_offset_ = end;
+  last_start_ = start;
 
+  if (start >= window_start_ && end <= window_end_) {
+    TEST_SYNC_POINT("BlobFilePrefetcher::Get:ServedFromWindow");
+    return reader_->GetImpl(options, handle, record, buffer, &window_,
+                            static_cast<size_t>(start - window_start_));
+  }
   return reader_->Get(options, handle, record, buffer);
 }
 
+void BlobFilePrefetcher::PrefetchRange(const ReadOptions& options,
+                                       uint64_t offset, uint64_t size) {
+  IOOptions io_options;
+  if (!reader_->PrepareIOOptions(options, &io_options).ok()) {
+    // The deadline is reported again by the reads of the range.
+    return;
+  }
+  Prefetch(offset, size, io_options);
+  last_offset_ = offset;
+  readahead_limit_ = offset + size;
+  readahead_size_ = std::min(kMaxReadaheadSize, size);
+}
+
+void BlobFilePrefetcher::Prefetch(uint64_t offset, uint64_t size,
+                                  const IOOptions& io_options) {
+  // The readahead doesn't go past the end of the file.
+  if (offset >= reader_->file_size_) {
+    return;
+  }
+  size = std::min(size, reader_->file_size_ - offset);
+  std::pair<uint64_t, uint64_t> range(offset, size);
+  TEST_SYNC_POINT_CALLBACK("BlobFilePrefetcher::Prefetch", &range);
+  if (!reader_->options_.blob_batched_read || reader_->mmap_reads_) {
+    reader_->file_->Prefetch(offset, size);
+    return;
+  }
+  // Reads the range into the window as a batch of requests, the reads
+  // within it are served from the window afterwards. The window is reused
+  // unless a value served from it is still pinned.
+  if (!window_ || window_.use_count() > 1) {
+    window_ = std::make_shared<std::string>();
+  }
+  if (window_->size() < size) {
+    window_->resize(static_cast<size_t>(size));
+  }
+  size_t read_size = 0;
+  Status s =
+      BatchedRead(reader_->file_.get(), offset, static_cast<size_t>(size),
+                  &(*window_)[0], nullptr /*rate_limiter*/, io_options,
+                  &read_size);
+  if (s.ok()) {
+    // The window ends early if the file is shorter than expected.
+    window_start_ = offset;
+    window_end_ = offset + read_size;
+  } else {
+    // Falls back to reading the records one by one.
+    window_start_ = window_end_ = 0;
+  }
+}
+
 Status InitUncompressionDict(
     const BlobFileFooter& footer, RandomAccessFileReader* file,
-    std::unique_ptr<UncompressionDict>* uncompression_dict) {
-  // TODO: Cache the compression dictionary in either block cache or blob cache.
+    Cache* cache, const BlobCacheKey& cache_key,
+    std::shared_ptr<UncompressionDict>* uncompression_dict) {
 #if ZSTD_VERSION_NUMBER < 10103
   return Status::NotSupported("the version of libztsd is too low");
 #endif
+  if (cache) {
+    auto cache_handle = cache->Lookup(cache_key.AsSlice());
+    if (cache_handle) {
+      *uncompression_dict =
+          *reinterpret_cast<std::shared_ptr<UncompressionDict>*>(
+              cache->Value(cache_handle));
+      cache->Release(cache_handle);
+      return Status::OK();
+    }
+  }
+  TEST_SYNC_POINT("InitUncompressionDict:Load");
   // 1. read meta index block
   // 2. read dictionary
   // 3. reset the dictionary
@@ -285,6 +1129,13 @@ Status InitUncompressionDict(
 
   std::string dict_str(dict_buf.get(), dict_buf.get() + dict_block.size());
   uncompression_dict->reset(new UncompressionDict(dict_str, true));
+  if (cache) {
+    auto cache_value =
+        new std::shared_ptr<UncompressionDict>(*uncompression_dict);
+    cache->Insert(cache_key.AsSlice(), cache_value,
+                  (*uncompression_dict)->ApproximateMemoryUsage(),
+                  &DeleteCacheValue<std::shared_ptr<UncompressionDict>>);
+  }
 
   return s;
 }
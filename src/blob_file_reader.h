@@ -1,6 +1,9 @@
 #pragma once
 
+#include <functional>
+
 #include "file/random_access_file_reader.h"
+#include "util/coding.h"
 
 #include "blob_format.h"
 #include "titan/options.h"
@@ -14,49 +17,241 @@ Status NewBlobFileReader(uint64_t file_number, uint64_t readahead_size,
                          const EnvOptions& env_options, Env* env,
                          std::unique_ptr<RandomAccessFileReader>* result);
 
+// Size of each request of BatchedRead().
+const size_t kBatchedReadRequestSize = 64 << 10;
+
+// Reads [offset, offset + size) of "file" into "scratch", as a batch of
+// requests issued with one MultiRead(). The default posix file system
+// submits the batch with io_uring if RocksDB is built with liburing. The
+// bytes are charged to "rate_limiter" if not null. If "read_size" is not
+// null, the read may stop early at the end of the file, and "*read_size"
+// is set to the bytes read. Otherwise a short read is a corruption.
+Status BatchedRead(RandomAccessFileReader* file, uint64_t offset, size_t size,
+                   char* scratch, RateLimiter* rate_limiter = nullptr,
+                   const IOOptions& io_options = IOOptions(),
+                   size_t* read_size = nullptr);
+
+// Key of a blob record in the blob cache. It is built on the stack without
+// allocation, and stays the same across reopens of the DB.
+//
+//    +--------------+-----------------+--------------+
+//    | cache id (4) | file number (6) |  offset (6)  |
+//    +--------------+-----------------+--------------+
+//
+// The cache id tells apart DBs sharing the same blob cache.
+class BlobCacheKey {
+ public:
+  static const size_t kEncodedLength = 16;
+
+  BlobCacheKey(uint32_t cache_id, uint64_t file_number, uint64_t offset) {
+    char buf[sizeof(uint64_t)];
+    EncodeFixed32(data_, cache_id);
+    EncodeFixed64(buf, file_number);
+    memcpy(data_ + 4, buf, 6);
+    EncodeFixed64(buf, offset);
+    memcpy(data_ + 10, buf, 6);
+  }
+
+  Slice AsSlice() const { return Slice(data_, kEncodedLength); }
+
+  // Decodes a key encoded by BlobCacheKey. Returns false if "key" is not
+  // of the encoded length.
+  static bool DecodeFrom(const Slice& key, uint32_t* cache_id,
+                         uint64_t* file_number, uint64_t* offset) {
+    if (key.size() != kEncodedLength) {
+      return false;
+    }
+    char buf[sizeof(uint64_t)] = {0};
+    *cache_id = DecodeFixed32(key.data());
+    memcpy(buf, key.data() + 4, 6);
+    *file_number = DecodeFixed64(buf);
+    memcpy(buf, key.data() + 10, 6);
+    *offset = DecodeFixed64(buf);
+    return true;
+  }
+
+ private:
+  char data_[kEncodedLength];
+};
+
+// A blob record kept in the blob cache. The record is uncompressed, or
+// kept in its compressed form if "compression" is not kNoCompression, see
+// `TitanCFOptions::blob_cache_compressed_ratio`.
+struct BlobCacheValue {
+  OwnedSlice data;
+  CompressionType compression{kNoCompression};
+};
+
+// Returns whether the blob record with "cache_key" is in "cache". The
+// secondary cache of "cache" is not looked up.
+bool IsBlobCached(Cache* cache, const BlobCacheKey& cache_key);
+
+// Inserts the blob record written to a blob file into "cache" with
+// "cache_key", as if it were read. "encoded_record" is the uncompressed
+// record encoded by BlobRecord::EncodeTo().
+void InsertBlobCache(Cache* cache, const BlobCacheKey& cache_key,
+                     const Slice& encoded_record);
+
+// A request of batched blob reads. The result of the request is stored in
+// "*record", "*buffer" and "*status", which must be valid when the request
+// is served.
+struct BlobReadRequest {
+  BlobHandle handle;
+  BlobRecord* record{nullptr};
+  PinnableSlice* buffer{nullptr};
+  Status* status{nullptr};
+};
+
 class BlobFileReader {
  public:
   // Opens a blob file and read the necessary metadata from it.
   // If successful, sets "*result" to the newly opened file reader.
+  // "blob_cache_id" is the cache id of the blob cache keys, see
+  // BlobCacheKey. If "admission" is not null, it counts the reads of the
+  // records to decide whether to insert them into the blob cache, see
+  // `TitanCFOptions::blob_cache_admission_frequency`. The deadlines of the
+  // reads are checked with "clock".
   static Status Open(const TitanCFOptions& options,
                      std::unique_ptr<RandomAccessFileReader> file,
-                     uint64_t file_size,
+                     uint64_t file_number, uint64_t file_size,
                      std::unique_ptr<BlobFileReader>* result,
-                     TitanStats* stats);
+                     TitanStats* stats, SystemClock* clock,
+                     uint32_t blob_cache_id = 0,
+                     std::shared_ptr<FrequencySketch> admission = nullptr);
 
   // Gets the blob record pointed by the handle in this file. The data
   // of the record is stored in the provided buffer, so the buffer
-  // must be valid when the record is used.
+  // must be valid when the record is used. If the file is memory mapped,
+  // an uncompressed record is pinned in the mapping without copying.
+  // The record is inserted into the blob cache only if
+  // `options.fill_cache` is set and it passes the admission. The reads of
+  // the file are bounded by `options.deadline` and `options.io_timeout`,
+  // and TimedOut is returned without reading once the deadline passed.
   Status Get(const ReadOptions& options, const BlobHandle& handle,
              BlobRecord* record, PinnableSlice* buffer);
 
+  // Gets the blob records pointed by the requests in this file. The
+  // requests are served in offset order, and neighbouring records are
+  // fetched with a single read.
+  void MultiGet(const ReadOptions& options,
+                std::vector<BlobReadRequest>* requests);
+
+  // Gets up to "length" bytes of the value of the blob record pointed by
+  // the handle, starting at "offset" of the value. "key" must be the key
+  // of the record. For an uncompressed record only the bytes up to the
+  // range are read, and its checksum is not verified. A compressed record
+  // is read whole. The range is copied into "*value".
+  Status GetRange(const ReadOptions& options, const BlobHandle& handle,
+                  const Slice& key, uint64_t offset, uint64_t length,
+                  PinnableSlice* value);
+
+  // Reads the value of the blob record pointed by the handle in chunks of
+  // at most "chunk_size" bytes, and calls "callback" with each chunk in
+  // order until it returns false. "key" must be the key of the record.
+  // If the value is stored in chunks (see BlobValueChunks), they are read
+  // kMaxParallelChunkReads at once, and each one is delivered as soon as
+  // its checksum is verified. Otherwise the record is read whole and
+  // verified before the first chunk is delivered.
+  Status GetChunks(const ReadOptions& options, const BlobHandle& handle,
+                   const Slice& key, size_t chunk_size,
+                   const std::function<bool(const Slice&)>& callback);
+
+  // Reads the record at "offset" into the blob cache, unless it is cached
+  // already or there is no blob cache. The size of the record is read from
+  // its header, and the bytes read are charged to "rate_limiter" if not
+  // null. The admission of the blob cache is bypassed.
+  Status LoadIntoCache(uint64_t offset, RateLimiter* rate_limiter);
+
  private:
   friend class BlobFilePrefetcher;
 
   BlobFileReader(const TitanCFOptions& options,
                  std::unique_ptr<RandomAccessFileReader> file,
-                 TitanStats* stats);
+                 uint64_t file_number, uint64_t file_size,
+                 uint32_t blob_cache_id,
+                 std::shared_ptr<FrequencySketch> admission,
+                 TitanStats* stats, SystemClock* clock);
 
-  Status ReadRecord(const BlobHandle& handle, BlobRecord* record,
-                    OwnedSlice* buffer);
+  // Prepares the options of the reads for "options", so that the reads are
+  // bounded by its `deadline` and `io_timeout`. It fails with TimedOut if
+  // the deadline has passed.
+  Status PrepareIOOptions(const ReadOptions& options,
+                          IOOptions* io_options) const;
+
+  BlobCacheKey GetCacheKey(uint64_t offset) const {
+    return BlobCacheKey(blob_cache_id_, file_number_, offset);
+  }
+
+  // Gets the record like Get(). If "window" is not null, it holds the
+  // "handle.size" bytes of the record at "window_offset", which are decoded
+  // instead of read. An uncompressed value not inserted into the blob
+  // cache is pinned to "window" instead of copied.
+  Status GetImpl(const ReadOptions& options, const BlobHandle& handle,
+                 BlobRecord* record, PinnableSlice* buffer,
+                 const std::shared_ptr<std::string>* window,
+                 size_t window_offset);
+
+  // Reads and decodes the record. If "compressed" is not null and the
+  // record is compressed, the compressed form is kept in "*compressed".
+  Status ReadRecord(const IOOptions& io_options, const BlobHandle& handle,
+                    BlobRecord* record, OwnedSlice* buffer,
+                    BlobCacheValue* compressed = nullptr);
+  // Decodes the record in "blob", which is stored in "ubuf".
+  Status DecodeRecord(Slice blob, CacheAllocationPtr ubuf, BlobRecord* record,
+                      OwnedSlice* buffer, BlobCacheValue* compressed);
+  // Returns where to keep the compressed form of a record read to be
+  // cached, or nullptr if records are cached uncompressed.
+  BlobCacheValue* CompressedCacheValue(bool fill_cache,
+                                       BlobCacheValue* compressed) const {
+    return fill_cache && options_.blob_cache_compressed_ratio > 0 ? compressed
+                                                                  : nullptr;
+  }
+  // Counts the read of the record with "cache_key", and returns whether
+  // the record should be inserted into the blob cache on a miss.
+  bool ShouldFillCache(const ReadOptions& options, const Slice& cache_key);
+  // Looks up the blob cache, including its secondary cache if any.
+  Cache::Handle* LookupBlob(const Slice& cache_key);
+  // Decodes the cached blob into "record" and pins it to "buffer". The
+  // cache handle is released by "buffer", or here if the blob is
+  // uncompressed from a compressed cached form.
+  Status PinCachedBlob(Cache::Handle* cache_handle, BlobRecord* record,
+                       PinnableSlice* buffer);
+  // Pins the decoded blob to "buffer", inserts it into the blob cache
+  // with "cache_key" if "fill_cache" is set. The compressed form in
+  // "compressed" is cached instead if it is compressed well enough.
+  void PinBlob(const Slice& cache_key, OwnedSlice* blob,
+               BlobCacheValue* compressed, bool fill_cache,
+               PinnableSlice* buffer);
   static Status ReadHeader(std::unique_ptr<RandomAccessFileReader>& file,
                            BlobFileHeader* header);
 
   TitanCFOptions options_;
-  std::unique_ptr<RandomAccessFileReader> file_;
+  // Shared with the values pinned into the file mapping in mmap mode.
+  std::shared_ptr<RandomAccessFileReader> file_;
+  // Whether the file serves reads from a memory mapping, see
+  // `allow_mmap_reads`.
+  bool mmap_reads_{false};
 
+  uint64_t file_number_;
+  // port::kMaxUint64 for a blob log, which may still grow.
+  uint64_t file_size_;
   std::shared_ptr<Cache> cache_;
-  std::string cache_prefix_;
+  uint32_t blob_cache_id_;
+  std::shared_ptr<FrequencySketch> admission_;
 
   // Information read from the file.
   BlobFileFooter footer_;
 
-  std::unique_ptr<UncompressionDict> uncompression_dict_ = nullptr;
+  // Shared with the other readers of the file through the blob cache.
+  std::shared_ptr<UncompressionDict> uncompression_dict_ = nullptr;
 
   TitanStats* stats_;
+  SystemClock* clock_;
 };
 
-// Performs readahead on continuous reads.
+// Performs readahead on continuous reads, in either direction. Backward
+// continuous reads, like those of an iterator moving with Prev(), read
+// ahead toward lower offsets.
 class BlobFilePrefetcher : public Cleanable {
  public:
   // Constructs a prefetcher with the blob file reader.
@@ -66,19 +261,51 @@ class BlobFilePrefetcher : public Cleanable {
   Status Get(const ReadOptions& options, const BlobHandle& handle,
              BlobRecord* record, PinnableSlice* buffer);
 
+  // Reads ahead [offset, offset + size), which is expected to be read
+  // sequentially from "offset" next. Reads within the range don't issue
+  // further readahead. The readahead is bounded by the deadline of
+  // "options".
+  void PrefetchRange(const ReadOptions& options, uint64_t offset,
+                     uint64_t size);
+
  private:
+  void Prefetch(uint64_t offset, uint64_t size, const IOOptions& io_options);
+
   BlobFileReader* reader_;
+  // The end and the start offset of the last read record.
   uint64_t last_offset_{0};
+  uint64_t last_start_{0};
   uint64_t readahead_size_{0};
+  // The range [readahead_start_, readahead_limit_) has been read ahead.
   uint64_t readahead_limit_{0};
+  uint64_t readahead_start_{port::kMaxUint64};
+  // With `blob_batched_read`, the range [window_start_, window_end_) read
+  // ahead is kept in "window_". It only grows, and is shared with the
+  // values pinned to it.
+  std::shared_ptr<std::string> window_;
+  uint64_t window_start_{0};
+  uint64_t window_end_{0};
 };
 
 // Init uncompression dictionary
 // called by BlobFileReader and BlobFileIterator when blob file has
-// uncompression dictionary
+// uncompression dictionary. If "cache" is not null, the digested
+// dictionary is shared through it with "cache_key", see
+// GetUncompressionDictCacheKey().
 Status InitUncompressionDict(
     const BlobFileFooter& footer, RandomAccessFileReader* file,
-    std::unique_ptr<UncompressionDict>* uncompression_dict);
+    Cache* cache, const BlobCacheKey& cache_key,
+    std::shared_ptr<UncompressionDict>* uncompression_dict);
+
+// Returns the blob cache key of the uncompression dictionary of the blob
+// file. It is keyed by the offset of the meta index block, which never
+// collides with a record.
+inline BlobCacheKey GetUncompressionDictCacheKey(uint32_t blob_cache_id,
+                                                 uint64_t file_number,
+                                                 const BlobFileFooter& footer) {
+  return BlobCacheKey(blob_cache_id, file_number,
+                      footer.meta_index_handle.offset());
+}
 
 }  // namespace titandb
 }  // namespace rocksdb
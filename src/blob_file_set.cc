@@ -2,6 +2,8 @@
 
 #include <cinttypes>
 
+#include "blob_file_iterator.h"
+#include "blob_file_reader.h"
 #include "edit_collector.h"
 #include "titan_logging.h"
 
@@ -16,15 +18,21 @@ BlobFileSet::BlobFileSet(const TitanDBOptions& options, TitanStats* stats)
       env_options_(options),
       db_options_(options),
       stats_(stats) {
-  auto file_cache_size = db_options_.max_open_files;
+  auto file_cache_size = db_options_.max_open_blob_files;
+  if (file_cache_size < 0) {
+    file_cache_size = db_options_.max_open_files;
+  }
   if (file_cache_size < 0) {
     file_cache_size = kMaxFileCacheSize;
   }
-  file_cache_ = NewLRUCache(file_cache_size);
+  file_cache_ = NewLRUCache(file_cache_size,
+                            db_options_.blob_file_cache_numshardbits);
 }
 
 Status BlobFileSet::Open(
-    const std::map<uint32_t, TitanCFOptions>& column_families) {
+    const std::map<uint32_t, TitanCFOptions>& column_families,
+    uint32_t blob_cache_id) {
+  blob_cache_id_ = blob_cache_id;
   // Sets up initial column families.
   AddColumnFamilies(column_families);
 
@@ -90,6 +98,47 @@ Status BlobFileSet::Recover() {
                    "Next blob file number is %" PRIu64 ".", next_file_number);
   }
 
+  // The blob logs are created without recording the file number to the
+  // manifest, so the file numbers of the files left are skipped.
+  std::vector<std::string> files;
+  env_->GetChildren(dirname_, &files);
+  for (const auto& f : files) {
+    uint64_t file_number;
+    FileType file_type;
+    if (ParseFileName(f, &file_number, &file_type) &&
+        file_type == FileType::kBlobFile &&
+        file_number >= next_file_number_.load()) {
+      next_file_number_.store(file_number + 1);
+    }
+  }
+
+  // The blob files known to the manifest, live or obsolete. A blob log is
+  // added to the manifest once sealed, so a blob log unknown to the
+  // manifest was never sealed. The obsolete files are deleted before the
+  // new manifest forgets them, so that an obsolete blob log is never taken
+  // as one never sealed.
+  std::set<uint64_t> manifest_files;
+  for (const auto& bs : column_families_) {
+    for (const auto& f : bs.second->files_) {
+      manifest_files.insert(f.first);
+      if (f.second->is_obsolete()) {
+        env_->DeleteFile(BlobFileName(dirname_, f.first));
+      }
+    }
+  }
+  for (const auto& f : files) {
+    uint64_t file_number;
+    FileType file_type;
+    if (ParseFileName(f, &file_number, &file_type) &&
+        file_type == FileType::kBlobFile &&
+        manifest_files.find(file_number) == manifest_files.end()) {
+      // The recovered blob logs are saved by the snapshot of the new
+      // manifest.
+      s = RecoverBlobLog(file_number);
+      if (!s.ok()) return s;
+    }
+  }
+
   auto new_manifest_file_number = NewFileNumber();
   s = OpenManifest(new_manifest_file_number);
   if (!s.ok()) return s;
@@ -118,8 +167,6 @@ Status BlobFileSet::Recover() {
       alive_files.insert(f.second->file_number());
     }
   }
-  std::vector<std::string> files;
-  env_->GetChildren(dirname_, &files);
   for (const auto& f : files) {
     uint64_t file_number;
     FileType file_type;
@@ -136,6 +183,75 @@ Status BlobFileSet::Recover() {
   return Status::OK();
 }
 
+Status BlobFileSet::RecoverBlobLog(uint64_t file_number) {
+  uint64_t file_size = 0;
+  Status s =
+      env_->GetFileSize(BlobFileName(dirname_, file_number), &file_size);
+  if (!s.ok()) return s;
+  std::unique_ptr<RandomAccessFileReader> file;
+  s = NewBlobFileReader(file_number, 0 /*readahead_size*/, db_options_,
+                        env_options_, env_, &file);
+  if (!s.ok()) return s;
+  char header_buf[BlobFileHeader::kMaxEncodedLength];
+  Slice slice;
+  s = file->Read(IOOptions(), 0, BlobFileHeader::kMaxEncodedLength, &slice,
+                 header_buf, nullptr /*aligned_buf*/);
+  if (!s.ok()) return s;
+  BlobFileHeader header;
+  if (!DecodeInto(slice, &header, true /*ignore_extra_bytes*/).ok() ||
+      !(header.flags & BlobFileHeader::kBlobLog)) {
+    // Not a blob log, or torn before the header is written.
+    return Status::OK();
+  }
+  auto it = column_families_.find(header.column_family_id);
+  if (it == column_families_.end()) {
+    return Status::OK();
+  }
+
+  TitanCFOptions cf_options = it->second->cf_options();
+  BlobFileIterator iter(std::move(file), file_number, file_size, cf_options);
+  const Comparator* cmp = cf_options.comparator;
+  uint64_t valid_size = header.size();
+  uint64_t num_entries = 0;
+  uint64_t live_data_size = 0;
+  std::string smallest_key, largest_key;
+  for (iter.SeekToFirst(); iter.Valid(); iter.Next()) {
+    auto handle = iter.GetBlobIndex().blob_handle;
+    valid_size = handle.offset + handle.size;
+    live_data_size += handle.size;
+    num_entries++;
+    if (num_entries == 1 || cmp->Compare(iter.key(), smallest_key) < 0) {
+      smallest_key = iter.key().ToString();
+    }
+    if (num_entries == 1 || cmp->Compare(iter.key(), largest_key) > 0) {
+      largest_key = iter.key().ToString();
+    }
+  }
+  if (num_entries == 0) {
+    return Status::OK();
+  }
+  if (valid_size < file_size) {
+    // The torn tail is left in the file, but out of the recovered size.
+    TITAN_LOG_WARN(db_options_.info_log,
+                   "Titan recovery drops the torn tail of blob log %" PRIu64
+                   ", keeping %" PRIu64 " of %" PRIu64 " bytes: %s",
+                   file_number, valid_size, file_size,
+                   iter.status().ToString().c_str());
+  }
+
+  auto meta = std::make_shared<BlobFileMeta>(file_number, valid_size,
+                                             num_entries, 0 /*file_level*/,
+                                             smallest_key, largest_key);
+  meta->set_live_data_size(live_data_size);
+  meta->InitLiveDataBitset(num_entries);
+  it->second->AddBlobFile(meta);
+  TITAN_LOG_INFO(db_options_.info_log,
+                 "Titan recovery adds blob log %" PRIu64 " of CF %" PRIu32
+                 " with %" PRIu64 " records.",
+                 file_number, header.column_family_id, num_entries);
+  return Status::OK();
+}
+
 Status BlobFileSet::OpenManifest(uint64_t file_number) {
   Status s;
 
@@ -229,8 +345,8 @@ Status BlobFileSet::LogAndApply(VersionEdit& edit) {
 void BlobFileSet::AddColumnFamilies(
     const std::map<uint32_t, TitanCFOptions>& column_families) {
   for (auto& cf : column_families) {
-    auto file_cache = std::make_shared<BlobFileCache>(db_options_, cf.second,
-                                                      file_cache_, stats_);
+    auto file_cache = std::make_shared<BlobFileCache>(
+        db_options_, cf.second, file_cache_, stats_, blob_cache_id_);
     auto blob_storage = std::make_shared<BlobStorage>(
         db_options_, cf.second, cf.first, file_cache, stats_);
     if (stats_ != nullptr) {
@@ -238,6 +354,7 @@ void BlobFileSet::AddColumnFamilies(
     }
     column_families_.emplace(cf.first, blob_storage);
   }
+  PublishColumnFamilies();
 }
 
 Status BlobFileSet::DropColumnFamilies(
@@ -276,6 +393,7 @@ Status BlobFileSet::MaybeDestroyColumnFamily(uint32_t cf_id) {
     it->second->MarkDestroyed();
     if (it->second->MaybeRemove()) {
       column_families_.erase(it);
+      PublishColumnFamilies();
     }
     return Status::OK();
   }
@@ -310,6 +428,7 @@ Status BlobFileSet::DeleteBlobFilesInRanges(uint32_t cf_id,
 
 void BlobFileSet::GetObsoleteFiles(std::vector<std::string>* obsolete_files,
                                    SequenceNumber oldest_sequence) {
+  bool removed = false;
   for (auto it = column_families_.begin(); it != column_families_.end();) {
     auto& cf_id = it->first;
     auto& blob_storage = it->second;
@@ -326,16 +445,26 @@ void BlobFileSet::GetObsoleteFiles(std::vector<std::string>* obsolete_files,
     // deleted.
     if (blob_storage->MaybeRemove()) {
       it = column_families_.erase(it);
+      removed = true;
       continue;
     }
     ++it;
   }
+  if (removed) {
+    PublishColumnFamilies();
+  }
 
   obsolete_files->insert(obsolete_files->end(), obsolete_manifests_.begin(),
                          obsolete_manifests_.end());
   obsolete_manifests_.clear();
 }
 
+void BlobFileSet::PublishColumnFamilies() {
+  std::shared_ptr<const ColumnFamilyStorages> storages =
+      std::make_shared<ColumnFamilyStorages>(column_families_);
+  std::atomic_store(&published_column_families_, storages);
+}
+
 void BlobFileSet::GetAllFiles(std::vector<std::string>* files,
                               std::vector<VersionEdit>* edits) {
   std::vector<std::string> all_blob_files;
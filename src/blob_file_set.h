@@ -3,6 +3,7 @@
 #include <cstdint>
 
 #include <atomic>
+#include <memory>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -40,7 +41,10 @@ class BlobFileSet {
   // If the manifest exists, it will recover from the latest one.
   // It is a corruption if the persistent storage contains data
   // outside of the provided column families.
-  Status Open(const std::map<uint32_t, TitanCFOptions>& column_families);
+  // "blob_cache_id" identifies this DB in the keys of the blob cache, it
+  // must be stable across reopens, see BlobCacheKey.
+  Status Open(const std::map<uint32_t, TitanCFOptions>& column_families,
+              uint32_t blob_cache_id = 0);
 
   // Applies *edit and saved to the manifest.
   // REQUIRES: mutex is held
@@ -71,6 +75,9 @@ class BlobFileSet {
   // Allocates a new file number.
   uint64_t NewFileNumber() { return next_file_number_.fetch_add(1); }
 
+  // Returns the cache id of the blob cache keys of this DB.
+  uint32_t blob_cache_id() const { return blob_cache_id_; }
+
   // REQUIRES: mutex is held
   std::weak_ptr<BlobStorage> GetBlobStorage(uint32_t cf_id) {
     auto it = column_families_.find(cf_id);
@@ -80,6 +87,20 @@ class BlobFileSet {
     return std::weak_ptr<BlobStorage>();
   }
 
+  // Same as GetBlobStorage(), but reads the published copy of the column
+  // families, so it doesn't require the mutex. It is used on the read
+  // path.
+  std::weak_ptr<BlobStorage> GetBlobStorageUnlocked(uint32_t cf_id) const {
+    auto storages = std::atomic_load(&published_column_families_);
+    if (storages) {
+      auto it = storages->find(cf_id);
+      if (it != storages->end()) {
+        return it->second;
+      }
+    }
+    return std::weak_ptr<BlobStorage>();
+  }
+
   // REQUIRES: mutex is held
   void GetObsoleteFiles(std::vector<std::string>* obsolete_files,
                         SequenceNumber oldest_sequence);
@@ -101,13 +122,25 @@ class BlobFileSet {
 
   Status OpenManifest(uint64_t number);
 
+  // Adds the blob file "file_number" unknown to the manifest to its column
+  // family if it is a blob log not sealed before the crash, see
+  // BlobLogWriter. The records are recovered up to the first one that is
+  // torn or corrupted. Other files are left to the purge.
+  Status RecoverBlobLog(uint64_t file_number);
+
   Status WriteSnapshot(log::Writer* log);
 
+  // Publishes a copy of `column_families_` for GetBlobStorageUnlocked().
+  // Must be called whenever `column_families_` is changed.
+  // REQUIRES: mutex is held
+  void PublishColumnFamilies();
+
   std::string dirname_;
   Env* env_;
   EnvOptions env_options_;
   TitanDBOptions db_options_;
   std::shared_ptr<Cache> file_cache_;
+  uint32_t blob_cache_id_{0};
 
   TitanStats* stats_;
 
@@ -121,7 +154,12 @@ class BlobFileSet {
   // the dropped column family but the handler is not destroyed.
   std::unordered_set<uint32_t> obsolete_columns_;
 
-  std::unordered_map<uint32_t, std::shared_ptr<BlobStorage>> column_families_;
+  using ColumnFamilyStorages =
+      std::unordered_map<uint32_t, std::shared_ptr<BlobStorage>>;
+  ColumnFamilyStorages column_families_;
+  // Immutable copy of `column_families_`. It is replaced as a whole and
+  // accessed with std::atomic_load/atomic_store.
+  std::shared_ptr<const ColumnFamilyStorages> published_column_families_;
   std::unique_ptr<log::Writer> manifest_;
   std::atomic<uint64_t> next_file_number_{1};
   uint64_t manifest_file_number_;
@@ -1,6 +1,10 @@
 #include <cinttypes>
 
+#include "env/composite_env_wrapper.h"
 #include "file/filename.h"
+#include "port/port.h"
+#include "test_util/mock_time_env.h"
+#include "test_util/sync_point.h"
 #include "test_util/testharness.h"
 
 #include "blob_file_builder.h"
@@ -17,6 +21,7 @@ class BlobFileTest : public testing::Test {
   }
 
   ~BlobFileTest() {
+    compression_pool_->JoinAllThreads();
     env_->DeleteFile(file_name_);
     env_->DeleteDir(dirname_);
   }
@@ -51,6 +56,28 @@ class BlobFileTest : public testing::Test {
     return s;
   }
 
+  // Builds a blob file of "n" records.
+  void BuildBlobFile(const TitanDBOptions& db_options,
+                     const TitanCFOptions& cf_options, int n,
+                     BlobFileBuilder::OutContexts* contexts) {
+    std::unique_ptr<FSWritableFile> f;
+    ASSERT_OK(env_->GetFileSystem()->NewWritableFile(
+        file_name_, FileOptions(env_options_), &f, nullptr /*dbg*/));
+    WritableFileWriter file(std::move(f), file_name_,
+                            FileOptions(env_options_));
+    BlobFileBuilder builder(db_options, cf_options, &file);
+    for (int i = 0; i < n; i++) {
+      auto key = GenKey(i);
+      auto value = GenValue(i);
+      BlobRecord record;
+      record.key = key;
+      record.value = value;
+      AddRecord(&builder, record, *contexts);
+      ASSERT_OK(builder.status());
+    }
+    ASSERT_OK(Finish(&builder, *contexts));
+  }
+
   void TestBlobFilePrefetcher(TitanOptions options,
                               uint32_t blob_file_version = 0) {
     options.dirname = dirname_;
@@ -72,11 +99,14 @@ class BlobFileTest : public testing::Test {
     std::unique_ptr<BlobFileBuilder> builder;
     if (blob_file_version == 0) {
       // Default blob file version
-      builder.reset(new BlobFileBuilder(db_options, cf_options, file.get()));
+      builder.reset(new BlobFileBuilder(db_options, cf_options, file.get(),
+                                        BlobFileHeader::kVersion2,
+                                        compression_pool_.get()));
     } else {
       // Test with specific blob file version
       builder.reset(new BlobFileBuilder(db_options, cf_options, file.get(),
-                                        blob_file_version));
+                                        blob_file_version,
+                                        compression_pool_.get()));
     }
 
     for (int i = 0; i < n; i++) {
@@ -147,11 +177,14 @@ class BlobFileTest : public testing::Test {
     std::unique_ptr<BlobFileBuilder> builder;
     if (blob_file_version == 0) {
       // Default blob file version
-      builder.reset(new BlobFileBuilder(db_options, cf_options, file.get()));
+      builder.reset(new BlobFileBuilder(db_options, cf_options, file.get(),
+                                        BlobFileHeader::kVersion2,
+                                        compression_pool_.get()));
     } else {
       // Test with specific blob file version
       builder.reset(new BlobFileBuilder(db_options, cf_options, file.get(),
-                                        blob_file_version));
+                                        blob_file_version,
+                                        compression_pool_.get()));
     }
 
     for (int i = 0; i < n; i++) {
@@ -179,7 +212,9 @@ class BlobFileTest : public testing::Test {
     std::unique_ptr<BlobFileReader> blob_file_reader;
     ASSERT_OK(BlobFileReader::Open(cf_options,
                                    std::move(random_access_file_reader),
-                                   file_size, &blob_file_reader, nullptr));
+                                   file_number_, file_size, &blob_file_reader,
+                                   nullptr /*stats*/,
+                                   env_->GetSystemClock().get()));
     ASSERT_EQ(contexts.size(), n);
 
     for (int i = 0; i < n; i++) {
@@ -205,11 +240,44 @@ class BlobFileTest : public testing::Test {
       ASSERT_OK(blob_file_reader->Get(ro, blob_handle, &record, &buffer));
       ASSERT_EQ(record, expect);
     }
+
+    // Requests out of offset order, with a duplicate, in one batch.
+    std::vector<BlobRecord> records(n + 1);
+    std::vector<PinnableSlice> buffers(n + 1);
+    std::vector<Status> statuses(n + 1);
+    std::vector<BlobReadRequest> requests;
+    for (int i = 0; i <= n; i++) {
+      BlobReadRequest request;
+      request.handle = contexts[(n - i) % n]->new_blob_index.blob_handle;
+      request.record = &records[i];
+      request.buffer = &buffers[i];
+      request.status = &statuses[i];
+      requests.push_back(request);
+    }
+    for (int round = 0; round < 2; round++) {
+      if (round == 0) {
+        ASSERT_OK(cache.MultiGet(ro, file_number_, file_size, &requests));
+      } else {
+        blob_file_reader->MultiGet(ro, &requests);
+      }
+      for (int i = 0; i <= n; i++) {
+        ASSERT_OK(statuses[i]);
+        BlobRecord expect;
+        auto key = GenKey((n - i) % n);
+        auto value = GenValue((n - i) % n);
+        expect.key = key;
+        expect.value = value;
+        ASSERT_EQ(records[i], expect);
+        buffers[i].Reset();
+      }
+    }
   }
 
   Env* env_{Env::Default()};
   EnvOptions env_options_;
   std::string dirname_;
+  // Runs the parallel compression of the builders.
+  std::unique_ptr<ThreadPool> compression_pool_{NewThreadPool(4)};
   std::string file_name_;
   uint64_t file_number_{1};
 };
@@ -222,6 +290,108 @@ TEST_F(BlobFileTest, BlobFileReader) {
   TestBlobFileReader(options);
 }
 
+TEST_F(BlobFileTest, BlobFileReaderParallelCompression) {
+  TitanOptions options;
+  options.blob_file_compression = kLZ4Compression;
+  options.blob_file_compression_options.parallel_threads = 4;
+  TestBlobFileReader(options);
+  TestBlobFilePrefetcher(options);
+#if ZSTD_VERSION_NUMBER >= 10103
+  // The buffered samples are compressed in parallel with the dictionary.
+  options.blob_file_compression = kZSTD;
+  options.blob_file_compression_options.max_dict_bytes = 4000;
+  TestBlobFileReader(options);
+#endif
+}
+
+TEST_F(BlobFileTest, BlobFileReaderDirectIO) {
+  {
+    // Skips if the file system doesn't support direct I/O.
+    EnvOptions env_options;
+    env_options.use_direct_writes = true;
+    std::string file_name = dirname_ + "/direct_io_test";
+    std::unique_ptr<WritableFile> file;
+    Status s = env_->NewWritableFile(file_name, &file, env_options);
+    file.reset();
+    env_->DeleteFile(file_name);
+    if (!s.ok()) {
+      return;
+    }
+  }
+  TitanOptions options;
+  options.use_direct_reads = true;
+  TestBlobFileReader(options);
+  // The small records are copied out of the aligned buffers to be cached.
+  options.blob_cache = NewLRUCache(1 << 20);
+  TestBlobFileReader(options);
+  options.blob_file_compression = kLZ4Compression;
+  TestBlobFileReader(options);
+}
+
+TEST_F(BlobFileTest, BlobFileReaderMmap) {
+  TitanOptions options;
+  options.allow_mmap_reads = true;
+  TestBlobFileReader(options);
+  options.blob_cache = NewLRUCache(1 << 20);
+  TestBlobFileReader(options);
+  options.blob_file_compression = kLZ4Compression;
+  TestBlobFileReader(options);
+
+  // The pinned value is still valid after the file reader is evicted.
+  options.blob_cache.reset();
+  options.blob_file_compression = kNoCompression;
+  options.dirname = dirname_;
+  TitanDBOptions db_options(options);
+  TitanCFOptions cf_options(options);
+  BlobFileCache cache(db_options, cf_options, {NewLRUCache(128)}, nullptr);
+  BlobFileBuilder::OutContexts contexts;
+  {
+    std::unique_ptr<WritableFileWriter> file;
+    std::unique_ptr<FSWritableFile> f;
+    ASSERT_OK(env_->GetFileSystem()->NewWritableFile(
+        file_name_, FileOptions(env_options_), &f, nullptr /*dbg*/));
+    file.reset(new WritableFileWriter(std::move(f), file_name_,
+                                      FileOptions(env_options_)));
+    BlobFileBuilder builder(db_options, cf_options, file.get());
+    BlobRecord record;
+    auto key = GenKey(1);
+    auto value = GenValue(1);
+    record.key = key;
+    record.value = value;
+    AddRecord(&builder, record, contexts);
+    ASSERT_OK(Finish(&builder, contexts));
+  }
+  uint64_t file_size = 0;
+  ASSERT_OK(env_->GetFileSize(file_name_, &file_size));
+  BlobRecord record;
+  PinnableSlice buffer;
+  ASSERT_OK(cache.Get(ReadOptions(), file_number_, file_size,
+                      contexts[0]->new_blob_index.blob_handle, &record,
+                      &buffer));
+  cache.Evict(file_number_);
+  ASSERT_EQ(record.value.ToString(), GenValue(1));
+}
+
+TEST_F(BlobFileTest, BlobFileReaderCompressedCache) {
+  TitanOptions options;
+  options.blob_file_compression = kLZ4Compression;
+  options.blob_cache = NewLRUCache(1 << 20);
+  TestBlobFileReader(options);
+  size_t uncompressed_usage = options.blob_cache->GetUsage();
+
+  options.blob_cache = NewLRUCache(1 << 20);
+  options.blob_cache_compressed_ratio = 1;
+  TestBlobFileReader(options);
+  size_t compressed_usage = options.blob_cache->GetUsage();
+  ASSERT_LT(compressed_usage, uncompressed_usage);
+
+  // Records compressed worse than the threshold are cached uncompressed.
+  options.blob_cache = NewLRUCache(1 << 20);
+  options.blob_cache_compressed_ratio = 1 << 20;
+  TestBlobFileReader(options);
+  ASSERT_EQ(uncompressed_usage, options.blob_cache->GetUsage());
+}
+
 TEST_F(BlobFileTest, BlobFilePrefetcher) {
   TitanOptions options;
   TestBlobFilePrefetcher(options);
@@ -232,6 +402,335 @@ TEST_F(BlobFileTest, BlobFilePrefetcher) {
   TestBlobFilePrefetcher(options);
 }
 
+TEST_F(BlobFileTest, BlobFilePrefetcherBackward) {
+  TitanOptions options;
+  options.dirname = dirname_;
+  TitanDBOptions db_options(options);
+  TitanCFOptions cf_options(options);
+  const int n = 100;
+  BlobFileBuilder::OutContexts contexts;
+  BuildBlobFile(db_options, cf_options, n, &contexts);
+  uint64_t file_size = 0;
+  ASSERT_OK(env_->GetFileSize(file_name_, &file_size));
+
+  std::vector<std::pair<uint64_t, uint64_t>> prefetches;
+  SyncPoint::GetInstance()->SetCallBack(
+      "BlobFilePrefetcher::Prefetch", [&](void* arg) {
+        prefetches.push_back(
+            *reinterpret_cast<std::pair<uint64_t, uint64_t>*>(arg));
+      });
+  SyncPoint::GetInstance()->EnableProcessing();
+
+  BlobFileCache cache(db_options, cf_options, {NewLRUCache(128)}, nullptr);
+  std::unique_ptr<BlobFilePrefetcher> prefetcher;
+  ASSERT_OK(cache.NewPrefetcher(file_number_, file_size, &prefetcher));
+  for (int i = n - 1; i >= 0; i--) {
+    BlobRecord record;
+    PinnableSlice buffer;
+    BlobHandle blob_handle = contexts[i]->new_blob_index.blob_handle;
+    ASSERT_OK(prefetcher->Get(ReadOptions(), blob_handle, &record, &buffer));
+    ASSERT_EQ(record.value.ToString(), GenValue(i));
+  }
+
+  SyncPoint::GetInstance()->DisableProcessing();
+  SyncPoint::GetInstance()->ClearAllCallBacks();
+
+  // Every record but the first read one is covered by a readahead, which
+  // grows and extends toward lower offsets. The last one may be cut at the
+  // start of the file.
+  ASSERT_GT(prefetches.size(), 1);
+  ASSERT_LT(prefetches.size(), n / 2);
+  for (size_t i = 1; i < prefetches.size(); i++) {
+    ASSERT_LT(prefetches[i].first, prefetches[i - 1].first);
+    if (i + 1 < prefetches.size()) {
+      ASSERT_GE(prefetches[i].second, prefetches[i - 1].second);
+    }
+  }
+  ASSERT_LE(prefetches.back().first,
+            contexts[0]->new_blob_index.blob_handle.offset);
+}
+
+TEST_F(BlobFileTest, BlobFilePrefetcherBatchedRead) {
+  TitanOptions options;
+  options.dirname = dirname_;
+  TitanDBOptions db_options(options);
+  TitanCFOptions cf_options(options);
+  cf_options.blob_batched_read = true;
+  const int n = 100;
+  BlobFileBuilder::OutContexts contexts;
+  BuildBlobFile(db_options, cf_options, n, &contexts);
+  uint64_t file_size = 0;
+  ASSERT_OK(env_->GetFileSize(file_name_, &file_size));
+
+  std::atomic<int> num_window_reads{0};
+  SyncPoint::GetInstance()->SetCallBack(
+      "BlobFilePrefetcher::Get:ServedFromWindow",
+      [&](void*) { num_window_reads++; });
+  // The readahead is clamped to the end of the file.
+  SyncPoint::GetInstance()->SetCallBack(
+      "BlobFilePrefetcher::Prefetch", [&](void* arg) {
+        auto* range = static_cast<std::pair<uint64_t, uint64_t>*>(arg);
+        ASSERT_LE(range->first + range->second, file_size);
+      });
+  SyncPoint::GetInstance()->EnableProcessing();
+
+  BlobFileCache cache(db_options, cf_options, {NewLRUCache(128)}, nullptr);
+  std::unique_ptr<BlobFilePrefetcher> prefetcher;
+  // Reads forward then backward, the records are read from the read ahead
+  // windows but the first one of each direction.
+  ASSERT_OK(cache.NewPrefetcher(file_number_, file_size, &prefetcher));
+  // The values pinned to a window stay valid after the next readahead.
+  std::vector<BlobRecord> records(n);
+  std::vector<std::unique_ptr<PinnableSlice>> buffers;
+  for (int i = 0; i < n; i++) {
+    buffers.emplace_back(new PinnableSlice());
+    BlobHandle blob_handle = contexts[i]->new_blob_index.blob_handle;
+    ASSERT_OK(prefetcher->Get(ReadOptions(), blob_handle, &records[i],
+                              buffers.back().get()));
+  }
+  for (int i = 0; i < n; i++) {
+    ASSERT_EQ(records[i].key.ToString(), GenKey(i));
+    ASSERT_EQ(records[i].value.ToString(), GenValue(i));
+  }
+  buffers.clear();
+  ASSERT_OK(cache.NewPrefetcher(file_number_, file_size, &prefetcher));
+  for (int i = n - 1; i >= 0; i--) {
+    BlobRecord record;
+    PinnableSlice buffer;
+    BlobHandle blob_handle = contexts[i]->new_blob_index.blob_handle;
+    ASSERT_OK(prefetcher->Get(ReadOptions(), blob_handle, &record, &buffer));
+    ASSERT_EQ(record.key.ToString(), GenKey(i));
+    ASSERT_EQ(record.value.ToString(), GenValue(i));
+  }
+
+  SyncPoint::GetInstance()->DisableProcessing();
+  SyncPoint::GetInstance()->ClearAllCallBacks();
+
+  ASSERT_EQ(2 * (n - 1), num_window_reads.load());
+}
+
+TEST_F(BlobFileTest, BatchedReadAtEndOfFile) {
+  TitanOptions options;
+  options.dirname = dirname_;
+  TitanDBOptions db_options(options);
+  TitanCFOptions cf_options(options);
+  cf_options.blob_file_compression = kNoCompression;
+  BlobFileBuilder::OutContexts contexts;
+  BuildBlobFile(db_options, cf_options, 100, &contexts);
+  uint64_t file_size = 0;
+  ASSERT_OK(env_->GetFileSize(file_name_, &file_size));
+  ASSERT_GT(file_size, kBatchedReadRequestSize);
+
+  std::unique_ptr<RandomAccessFileReader> file;
+  ASSERT_OK(NewBlobFileReader(file_number_, 0, db_options, env_options_, env_,
+                              &file));
+  // The batch runs past the end of the file by more than one request.
+  uint64_t offset = 10;
+  size_t size = static_cast<size_t>(file_size) + 2 * kBatchedReadRequestSize;
+  std::string scratch(size, '\0');
+  ASSERT_TRUE(BatchedRead(file.get(), offset, size, &scratch[0])
+                  .IsCorruption());
+  size_t read_size = 0;
+  ASSERT_OK(BatchedRead(file.get(), offset, size, &scratch[0],
+                        nullptr /*rate_limiter*/, IOOptions(), &read_size));
+  ASSERT_EQ(file_size - offset, read_size);
+  std::string expected;
+  ASSERT_OK(ReadFileToString(env_, file_name_, &expected));
+  ASSERT_EQ(expected.substr(offset), scratch.substr(0, read_size));
+}
+
+TEST_F(BlobFileTest, BlobFileCacheSingleFlightOpen) {
+  TitanOptions options;
+  options.dirname = dirname_;
+  TitanDBOptions db_options(options);
+  TitanCFOptions cf_options(options);
+  BlobFileCache cache(db_options, cf_options, {NewLRUCache(128)}, nullptr);
+
+  const int n = 10;
+  BlobFileBuilder::OutContexts contexts;
+  BuildBlobFile(db_options, cf_options, n, &contexts);
+  uint64_t file_size = 0;
+  ASSERT_OK(env_->GetFileSize(file_name_, &file_size));
+
+  std::atomic<int> num_opens{0};
+  SyncPoint::GetInstance()->SetCallBack("BlobFileCache::FindFile:OpenFile",
+                                        [&](void*) { num_opens++; });
+  SyncPoint::GetInstance()->EnableProcessing();
+
+  std::vector<port::Thread> threads;
+  for (int t = 0; t < 8; t++) {
+    threads.emplace_back([&, t]() {
+      ReadOptions ro;
+      BlobRecord record;
+      PinnableSlice buffer;
+      BlobHandle blob_handle = contexts[t % n]->new_blob_index.blob_handle;
+      ASSERT_OK(cache.Get(ro, file_number_, file_size, blob_handle, &record,
+                          &buffer));
+      ASSERT_EQ(record.value.ToString(), GenValue(t % n));
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(1, num_opens.load());
+
+  SyncPoint::GetInstance()->DisableProcessing();
+  SyncPoint::GetInstance()->ClearAllCallBacks();
+}
+
+TEST_F(BlobFileTest, BlobCacheKeyAcrossReopen) {
+  TitanOptions options;
+  options.dirname = dirname_;
+  options.blob_cache = NewLRUCache(1 << 20);
+  TitanDBOptions db_options(options);
+  TitanCFOptions cf_options(options);
+  BlobFileBuilder::OutContexts contexts;
+  {
+    std::unique_ptr<WritableFileWriter> file;
+    std::unique_ptr<FSWritableFile> f;
+    ASSERT_OK(env_->GetFileSystem()->NewWritableFile(
+        file_name_, FileOptions(env_options_), &f, nullptr /*dbg*/));
+    file.reset(new WritableFileWriter(std::move(f), file_name_,
+                                      FileOptions(env_options_)));
+    BlobFileBuilder builder(db_options, cf_options, file.get());
+    BlobRecord record;
+    auto key = GenKey(1);
+    auto value = GenValue(1);
+    record.key = key;
+    record.value = value;
+    AddRecord(&builder, record, contexts);
+    ASSERT_OK(Finish(&builder, contexts));
+  }
+  uint64_t file_size = 0;
+  ASSERT_OK(env_->GetFileSize(file_name_, &file_size));
+  BlobHandle blob_handle = contexts[0]->new_blob_index.blob_handle;
+
+  auto get = [&](BlobFileCache* cache) {
+    BlobRecord record;
+    PinnableSlice buffer;
+    ASSERT_OK(cache->Get(ReadOptions(), file_number_, file_size, blob_handle,
+                         &record, &buffer));
+    ASSERT_EQ(record.value.ToString(), GenValue(1));
+  };
+
+  BlobFileCache cache(db_options, cf_options, {NewLRUCache(128)}, nullptr,
+                      1 /*blob_cache_id*/);
+  get(&cache);
+  size_t usage = options.blob_cache->GetUsage();
+  ASSERT_GT(usage, 0);
+
+  // A reopened reader of the same file hits the cached record.
+  cache.Evict(file_number_);
+  get(&cache);
+  ASSERT_EQ(usage, options.blob_cache->GetUsage());
+
+  // A different cache id doesn't.
+  BlobFileCache other_cache(db_options, cf_options, {NewLRUCache(128)},
+                            nullptr, 2 /*blob_cache_id*/);
+  get(&other_cache);
+  ASSERT_GT(options.blob_cache->GetUsage(), usage);
+}
+
+TEST_F(BlobFileTest, BlobCacheFillCacheAndAdmission) {
+  TitanOptions options;
+  options.dirname = dirname_;
+  options.blob_cache = NewLRUCache(1 << 20);
+  options.blob_cache_admission_frequency = 2;
+  TitanDBOptions db_options(options);
+  TitanCFOptions cf_options(options);
+  const int n = 10;
+  BlobFileBuilder::OutContexts contexts;
+  BuildBlobFile(db_options, cf_options, n, &contexts);
+  uint64_t file_size = 0;
+  ASSERT_OK(env_->GetFileSize(file_name_, &file_size));
+
+  BlobFileCache cache(db_options, cf_options, {NewLRUCache(128)}, nullptr);
+  auto get = [&](const ReadOptions& ro, int i) {
+    BlobRecord record;
+    PinnableSlice buffer;
+    ASSERT_OK(cache.Get(ro, file_number_, file_size,
+                        contexts[i]->new_blob_index.blob_handle, &record,
+                        &buffer));
+    ASSERT_EQ(record.value.ToString(), GenValue(i));
+  };
+
+  // Reads without fill_cache are neither inserted nor counted.
+  ReadOptions no_fill;
+  no_fill.fill_cache = false;
+  for (int i = 0; i < n; i++) {
+    get(no_fill, i);
+    get(no_fill, i);
+  }
+  ASSERT_EQ(0, options.blob_cache->GetUsage());
+
+  // A scan reading each record once doesn't fill the cache.
+  for (int i = 0; i < n; i++) {
+    get(ReadOptions(), i);
+  }
+  ASSERT_EQ(0, options.blob_cache->GetUsage());
+
+  // A record read twice is admitted.
+  get(ReadOptions(), 0);
+  size_t usage = options.blob_cache->GetUsage();
+  ASSERT_GT(usage, 0);
+  get(ReadOptions(), 0);
+  ASSERT_EQ(usage, options.blob_cache->GetUsage());
+}
+
+TEST_F(BlobFileTest, BlobFileReaderDeadline) {
+  TitanOptions options;
+  options.dirname = dirname_;
+  options.blob_cache = NewLRUCache(1 << 20);
+  TitanDBOptions db_options(options);
+  TitanCFOptions cf_options(options);
+  const int n = 10;
+  BlobFileBuilder::OutContexts contexts;
+  BuildBlobFile(db_options, cf_options, n, &contexts);
+  uint64_t file_size = 0;
+  ASSERT_OK(env_->GetFileSize(file_name_, &file_size));
+
+  // The deadlines are checked with the clock of the DB.
+  auto mock_clock = std::make_shared<MockSystemClock>(env_->GetSystemClock());
+  mock_clock->SetCurrentTime(100);
+  std::unique_ptr<Env> mock_env(new CompositeEnvWrapper(env_, mock_clock));
+  db_options.env = mock_env.get();
+  BlobFileCache cache(db_options, cf_options, {NewLRUCache(128)}, nullptr);
+  BlobHandle blob_handle = contexts[0]->new_blob_index.blob_handle;
+  ReadOptions expired;
+  expired.deadline = std::chrono::microseconds(1);
+  BlobRecord record;
+  PinnableSlice buffer;
+  // The deadline has passed, so the file is not read.
+  ASSERT_TRUE(cache.Get(expired, file_number_, file_size, blob_handle,
+                        &record, &buffer)
+                  .IsTimedOut());
+  ASSERT_EQ(0, options.blob_cache->GetUsage());
+  std::unique_ptr<BlobFilePrefetcher> prefetcher;
+  ASSERT_OK(cache.NewPrefetcher(file_number_, file_size, &prefetcher));
+  ASSERT_TRUE(
+      prefetcher->Get(expired, blob_handle, &record, &buffer).IsTimedOut());
+
+  // A read within the deadline succeeds, and a cached record is served
+  // after the deadline.
+  ReadOptions bounded;
+  bounded.deadline =
+      std::chrono::microseconds(mock_clock->NowMicros() + 60 * 1000 * 1000);
+  bounded.io_timeout = std::chrono::microseconds(10 * 1000 * 1000);
+  ASSERT_OK(cache.Get(bounded, file_number_, file_size, blob_handle, &record,
+                      &buffer));
+  ASSERT_EQ(record.value.ToString(), GenValue(0));
+  buffer.Reset();
+  mock_clock->MockSleepForSeconds(120);
+  ASSERT_OK(cache.Get(bounded, file_number_, file_size, blob_handle, &record,
+                      &buffer));
+  ASSERT_EQ(record.value.ToString(), GenValue(0));
+  buffer.Reset();
+  BlobHandle uncached_handle = contexts[1]->new_blob_index.blob_handle;
+  ASSERT_TRUE(cache.Get(bounded, file_number_, file_size, uncached_handle,
+                        &record, &buffer)
+                  .IsTimedOut());
+}
+
 }  // namespace titandb
 }  // namespace rocksdb
 
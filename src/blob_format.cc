@@ -17,9 +17,12 @@ bool GetChar(Slice* src, unsigned char* value) {
 
 }  // namespace
 
-void BlobRecord::EncodeTo(std::string* dst) const {
+void BlobRecord::EncodeTo(std::string* dst, uint32_t value_chunk_size) const {
   PutLengthPrefixedSlice(dst, key);
   PutLengthPrefixedSlice(dst, value);
+  if (value_chunk_size > 0 && value.size() > value_chunk_size) {
+    BlobValueChunks::EncodeTo(value, value_chunk_size, dst);
+  }
 }
 
 Status BlobRecord::DecodeFrom(Slice* src) {
@@ -27,24 +30,80 @@ Status BlobRecord::DecodeFrom(Slice* src) {
       !GetLengthPrefixedSlice(src, &value)) {
     return Status::Corruption("BlobRecord");
   }
+  if (!src->empty()) {
+    // The checksums of the chunks are only verified by chunked reads, the
+    // record is verified as a whole otherwise.
+    uint32_t chunk_size = 0;
+    if (!GetVarint32(src, &chunk_size) || chunk_size == 0) {
+      return Status::Corruption("BlobRecord", "chunk size");
+    }
+    uint64_t checksums_size =
+        BlobValueChunks::NumChunks(value.size(), chunk_size) * 4;
+    if (src->size() < checksums_size) {
+      return Status::Corruption("BlobRecord", "chunk checksums");
+    }
+    src->remove_prefix(checksums_size);
+  }
+  return Status::OK();
+}
+
+void BlobValueChunks::EncodeTo(const Slice& value, uint32_t chunk_size,
+                               std::string* dst) {
+  assert(chunk_size > 0);
+  PutVarint32(dst, chunk_size);
+  for (size_t pos = 0; pos < value.size(); pos += chunk_size) {
+    size_t n = std::min<size_t>(chunk_size, value.size() - pos);
+    PutFixed32(dst, crc32c::Mask(crc32c::Value(value.data() + pos, n)));
+  }
+}
+
+Status BlobValueChunks::DecodeFrom(Slice* src, uint64_t value_size) {
+  if (!GetVarint32(src, &chunk_size) || chunk_size == 0) {
+    return Status::Corruption("BlobValueChunks", "chunk size");
+  }
+  uint64_t num_chunks = NumChunks(value_size, chunk_size);
+  if (src->size() < num_chunks * 4) {
+    return Status::Corruption("BlobValueChunks", "checksums");
+  }
+  checksums.resize(num_chunks);
+  for (auto& checksum : checksums) {
+    GetFixed32(src, &checksum);
+  }
   return Status::OK();
 }
 
+bool BlobValueChunks::Verify(size_t index, const Slice& chunk) const {
+  uint32_t crc = crc32c::Value(chunk.data(), chunk.size());
+  TEST_SYNC_POINT_CALLBACK("BlobValueChunks::Verify", &crc);
+  return index < checksums.size() && crc32c::Unmask(checksums[index]) == crc;
+}
+
+bool IsChunkedBlobRecord(Slice encoded_record) {
+  Slice key, value;
+  return GetLengthPrefixedSlice(&encoded_record, &key) &&
+         GetLengthPrefixedSlice(&encoded_record, &value) &&
+         !encoded_record.empty();
+}
+
 bool operator==(const BlobRecord& lhs, const BlobRecord& rhs) {
   return lhs.key == rhs.key && lhs.value == rhs.value;
 }
 
 void BlobEncoder::EncodeRecord(const BlobRecord& record) {
   record_buffer_.clear();
-  record.EncodeTo(&record_buffer_);
+  record.EncodeTo(&record_buffer_, value_chunk_size_);
   EncodeSlice(record_buffer_);
 }
 
 void BlobEncoder::EncodeSlice(const Slice& record) {
   compressed_buffer_.clear();
-  CompressionType compression;
-  record_ =
-      Compress(*compression_info_, record, &compressed_buffer_, &compression);
+  CompressionType compression = kNoCompression;
+  if (IsChunkedBlobRecord(record)) {
+    record_ = record;
+  } else {
+    record_ = Compress(*compression_info_, record, &compressed_buffer_,
+                       &compression);
+  }
 
   assert(record_.size() < std::numeric_limits<uint32_t>::max());
   EncodeFixed32(header_ + 4, static_cast<uint32_t>(record_.size()));
@@ -233,6 +292,11 @@ void BlobFileMeta::FileStateTransit(const FileEvent& event) {
     case FileEvent::kReset:
       state_ = FileState::kNormal;
       break;
+    case FileEvent::kBlobLogSealed:
+      // The keys of a blob log are added to the LSM as it is written.
+      assert(state_ == FileState::kInit);
+      state_ = FileState::kNormal;
+      break;
     default:
       assert(false);
   }
@@ -277,6 +341,9 @@ void BlobFileHeader::EncodeTo(std::string* dst) const {
 
   if (version == BlobFileHeader::kVersion2) {
     PutFixed32(dst, flags);
+    if (flags & kBlobLog) {
+      PutFixed32(dst, column_family_id);
+    }
   }
 }
 
@@ -292,9 +359,13 @@ Status BlobFileHeader::DecodeFrom(Slice* src) {
   }
   if (version == BlobFileHeader::kVersion2) {
     // Check that no other flags are set
-    if (!GetFixed32(src, &flags) || flags & ~kHasUncompressionDictionary) {
+    if (!GetFixed32(src, &flags) ||
+        flags & ~(kHasUncompressionDictionary | kBlobLog)) {
       return Status::Corruption("Blob file header flags missing or invalid.");
     }
+    if ((flags & kBlobLog) && !GetFixed32(src, &column_family_id)) {
+      return Status::Corruption("Blob log header column family id missing.");
+    }
   }
   return Status::OK();
 }
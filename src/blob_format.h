@@ -50,11 +50,17 @@ const uint64_t kBlobFooterSize = BlockHandle::kMaxEncodedLength + 8 + 4;
 //    | Varint64 + key_len | Varint64 + value_len |
 //    +--------------------+----------------------+
 //
+// A value larger than `TitanCFOptions::blob_value_chunk_size` is followed by
+// the checksums of its chunks, see BlobValueChunks. The value itself stays
+// contiguous, and such a record is never compressed, so that its chunks can
+// be read and verified one by one.
 struct BlobRecord {
   Slice key;
   Slice value;
 
-  void EncodeTo(std::string* dst) const;
+  // Appends the checksums of the chunks of the value if "value_chunk_size"
+  // is positive and the value is larger than it.
+  void EncodeTo(std::string* dst, uint32_t value_chunk_size = 0) const;
   Status DecodeFrom(Slice* src);
 
   size_t size() const { return key.size() + value.size(); }
@@ -62,6 +68,38 @@ struct BlobRecord {
   friend bool operator==(const BlobRecord& lhs, const BlobRecord& rhs);
 };
 
+// Format of the checksums of the chunks of a value (not fixed size):
+//
+//    +------------+-------------+-----+-------------+
+//    | chunk size | chunk 1 crc | ... | chunk N crc |
+//    +------------+-------------+-----+-------------+
+//    |  Varint32  |   Fixed32   |     |   Fixed32   |
+//    +------------+-------------+-----+-------------+
+//
+// The value is split into chunks of "chunk size" bytes, except the last
+// one. The checksums are masked crc32c of the chunks.
+struct BlobValueChunks {
+  uint32_t chunk_size{0};
+  std::vector<uint32_t> checksums;
+
+  static uint64_t NumChunks(uint64_t value_size, uint32_t chunk_size) {
+    return (value_size + chunk_size - 1) / chunk_size;
+  }
+
+  // Encodes the checksums of the chunks of "value".
+  static void EncodeTo(const Slice& value, uint32_t chunk_size,
+                       std::string* dst);
+  // Decodes the checksums of the chunks of a value of "value_size" bytes.
+  Status DecodeFrom(Slice* src, uint64_t value_size);
+
+  // Returns whether "chunk" matches the checksum of the "index"-th chunk.
+  bool Verify(size_t index, const Slice& chunk) const;
+};
+
+// Returns whether the record encoded by BlobRecord::EncodeTo() in
+// "encoded_record" has its value in chunks.
+bool IsChunkedBlobRecord(Slice encoded_record);
+
 class BlobEncoder {
  public:
   BlobEncoder(CompressionType compression, CompressionOptions compression_opt,
@@ -83,7 +121,13 @@ class BlobEncoder {
                     &CompressionDict::GetEmptyDict()) {}
 
   void EncodeRecord(const BlobRecord& record);
+  // A record with its value in chunks is encoded uncompressed.
   void EncodeSlice(const Slice& record);
+  // Values larger than "value_chunk_size" are encoded in chunks by
+  // EncodeRecord(). Zero disables it.
+  void SetValueChunkSize(uint32_t value_chunk_size) {
+    value_chunk_size_ = value_chunk_size;
+  }
   void SetCompressionDict(const CompressionDict* compression_dict) {
     compression_dict_ = compression_dict;
     compression_info_.reset(new CompressionInfo(
@@ -98,6 +142,7 @@ class BlobEncoder {
 
  private:
   char header_[kRecordHeaderSize];
+  uint32_t value_chunk_size_{0};
   Slice record_;
   std::string record_buffer_;
   std::string compressed_buffer_;
@@ -125,6 +170,8 @@ class BlobDecoder {
 
   size_t GetRecordSize() const { return record_size_; }
 
+  CompressionType GetCompression() const { return compression_; }
+
  private:
   uint32_t crc_{0};
   uint32_t header_crc_{0};
@@ -213,6 +260,7 @@ class BlobFileMeta {
     kDelete,
     kNeedMerge,
     kReset,  // reset file to normal for test
+    kBlobLogSealed,
   };
 
   enum class FileState : int {
@@ -344,6 +392,9 @@ class BlobFileMeta {
 //    |   Fixed32    | Fixed32 | Fixed32 |
 //    +--------------+---------+---------+
 //
+// If the `kBlobLog` flag is set, the flags are followed by the column family
+// id in Fixed32.
+//
 // The header is mean to be compatible with header of BlobDB blob files, except
 // we use a different magic number.
 struct BlobFileHeader {
@@ -353,13 +404,19 @@ struct BlobFileHeader {
   static const uint32_t kVersion2 = 2;
 
   static const uint64_t kMinEncodedLength = 4 + 4;
-  static const uint64_t kMaxEncodedLength = 4 + 4 + 4;
+  static const uint64_t kMaxEncodedLength = 4 + 4 + 4 + 4;
 
   // Flags:
   static const uint32_t kHasUncompressionDictionary = 1 << 0;
+  // The file is a blob log written by `TitanCFOptions::separate_blob_on_write`.
+  // Its records are in the order they are written rather than in key order,
+  // and they are followed by neither meta blocks nor a footer.
+  static const uint32_t kBlobLog = 1 << 1;
 
   uint32_t version = kVersion2;
   uint32_t flags = 0;
+  // Only set for a blob log.
+  uint32_t column_family_id = 0;
 
   static Status ValidateVersion(uint32_t ver) {
     if (ver != BlobFileHeader::kVersion1 && ver != BlobFileHeader::kVersion2) {
@@ -370,9 +427,11 @@ struct BlobFileHeader {
   }
 
   uint64_t size() const {
-    return version == BlobFileHeader::kVersion1
-               ? BlobFileHeader::kMinEncodedLength
-               : BlobFileHeader::kMaxEncodedLength;
+    if (version == BlobFileHeader::kVersion1) {
+      return BlobFileHeader::kMinEncodedLength;
+    }
+    return (flags & kBlobLog) ? BlobFileHeader::kMaxEncodedLength
+                              : BlobFileHeader::kMaxEncodedLength - 4;
   }
 
   void EncodeTo(std::string* dst) const;
@@ -18,6 +18,52 @@ TEST(BlobFormatTest, BlobRecord) {
   CheckCodec(input);
 }
 
+TEST(BlobFormatTest, BlobRecordInChunks) {
+  std::string value(10, 'v');
+  value[9] = 'w';
+  BlobRecord input;
+  input.key = "hello";
+  input.value = value;
+  std::string encoded;
+  input.EncodeTo(&encoded, 4 /*value_chunk_size*/);
+  ASSERT_TRUE(IsChunkedBlobRecord(encoded));
+  BlobRecord output;
+  ASSERT_OK(DecodeInto(encoded, &output));
+  ASSERT_EQ(input, output);
+
+  // The checksums follow the value.
+  Slice src(encoded);
+  src.remove_prefix(output.value.data() + output.value.size() -
+                    encoded.data());
+  BlobValueChunks chunks;
+  ASSERT_OK(chunks.DecodeFrom(&src, value.size()));
+  ASSERT_TRUE(src.empty());
+  ASSERT_EQ(4U, chunks.chunk_size);
+  ASSERT_EQ(3U, chunks.checksums.size());
+  ASSERT_TRUE(chunks.Verify(0, Slice(value.data(), 4)));
+  ASSERT_TRUE(chunks.Verify(2, Slice(value.data() + 8, 2)));
+  ASSERT_FALSE(chunks.Verify(2, Slice(value.data(), 2)));
+  ASSERT_FALSE(chunks.Verify(3, Slice(value.data() + 8, 2)));
+
+  // A value not larger than the chunk size is not in chunks.
+  encoded.clear();
+  input.EncodeTo(&encoded, 10 /*value_chunk_size*/);
+  ASSERT_FALSE(IsChunkedBlobRecord(encoded));
+
+  // A record in chunks is never compressed.
+  BlobEncoder encoder(kLZ4Compression);
+  encoder.SetValueChunkSize(4);
+  encoder.EncodeRecord(input);
+  Slice encoded_header = encoder.GetHeader();
+  Slice encoded_record = encoder.GetRecord();
+  BlobDecoder decoder;
+  ASSERT_OK(decoder.DecodeHeader(&encoded_header));
+  ASSERT_EQ(kNoCompression, decoder.GetCompression());
+  OwnedSlice blob;
+  ASSERT_OK(decoder.DecodeRecord(&encoded_record, &output, &blob));
+  ASSERT_EQ(input, output);
+}
+
 TEST(BlobFormatTest, BlobHandle) {
   BlobHandle input;
   CheckCodec(input);
@@ -48,6 +94,28 @@ TEST(BlobFormatTest, BlobFileFooter) {
   CheckCodec(input);
 }
 
+TEST(BlobFormatTest, BlobFileHeader) {
+  BlobFileHeader input;
+  ASSERT_EQ(input.size(), 12);
+  input.flags |= BlobFileHeader::kBlobLog;
+  input.column_family_id = 7;
+  ASSERT_EQ(input.size(), 16);
+  std::string encoded;
+  input.EncodeTo(&encoded);
+  ASSERT_EQ(encoded.size(), input.size());
+
+  BlobFileHeader output;
+  Slice slice(encoded);
+  ASSERT_OK(output.DecodeFrom(&slice));
+  ASSERT_TRUE(output.flags & BlobFileHeader::kBlobLog);
+  ASSERT_EQ(output.column_family_id, 7u);
+  ASSERT_EQ(output.size(), input.size());
+
+  // A blob log header without the column family id is torn.
+  slice = Slice(encoded.data(), encoded.size() - 4);
+  ASSERT_TRUE(output.DecodeFrom(&slice).IsCorruption());
+}
+
 TEST(BlobFormatTest, BlobFileStateTransit) {
   BlobFileMeta blob_file;
   ASSERT_EQ(blob_file.file_state(), BlobFileMeta::FileState::kInit);
@@ -66,6 +134,10 @@ TEST(BlobFormatTest, BlobFileStateTransit) {
   compaction_output.FileStateTransit(
       BlobFileMeta::FileEvent::kCompactionCompleted);
   ASSERT_EQ(compaction_output.file_state(), BlobFileMeta::FileState::kNormal);
+
+  BlobFileMeta blob_log;
+  blob_log.FileStateTransit(BlobFileMeta::FileEvent::kBlobLogSealed);
+  ASSERT_EQ(blob_log.file_state(), BlobFileMeta::FileState::kNormal);
 }
 
 TEST(BlobFormatTest, BlobCompressionLZ4) {
@@ -87,7 +87,8 @@ BlobGCJob::BlobGCJob(BlobGC* blob_gc, DB* db, port::Mutex* mutex,
                      const EnvOptions& env_options,
                      BlobFileManager* blob_file_manager,
                      BlobFileSet* blob_file_set, LogBuffer* log_buffer,
-                     std::atomic_bool* shuting_down, TitanStats* stats)
+                     std::atomic_bool* shuting_down, TitanStats* stats,
+                     ThreadPool* compression_pool)
     : blob_gc_(blob_gc),
       base_db_(db),
       base_db_impl_(reinterpret_cast<DBImpl*>(base_db_)),
@@ -99,7 +100,8 @@ BlobGCJob::BlobGCJob(BlobGC* blob_gc, DB* db, port::Mutex* mutex,
       blob_file_set_(blob_file_set),
       log_buffer_(log_buffer),
       shuting_down_(shuting_down),
-      stats_(stats) {}
+      stats_(stats),
+      compression_pool_(compression_pool) {}
 
 BlobGCJob::~BlobGCJob() {
   if (log_buffer_) {
@@ -263,7 +265,8 @@ Status BlobGCJob::DoRunGC() {
                      blob_file_handle->GetNumber());
       blob_file_builder = std::unique_ptr<BlobFileBuilder>(
           new BlobFileBuilder(db_options_, blob_gc_->titan_cf_options(),
-                              blob_file_handle->GetFile()));
+                              blob_file_handle->GetFile(),
+                              BlobFileHeader::kVersion2, compression_pool_));
       file_size = 0;
     }
     assert(blob_file_handle);
@@ -284,6 +287,9 @@ Status BlobGCJob::DoRunGC() {
     ctx->key = ikey.Encode().ToString();
     ctx->original_blob_index = blob_index;
     ctx->new_blob_index.file_number = blob_file_handle->GetNumber();
+    if (ShouldFillBlobCache(blob_index)) {
+      blob_record.EncodeTo(&ctx->cache_record);
+    }
 
     BlobFileBuilder::OutContexts contexts;
     blob_file_builder->Add(blob_record, std::move(ctx), &contexts);
@@ -334,6 +340,15 @@ void BlobGCJob::BatchWriteNewIndices(BlobFileBuilder::OutContexts& contexts,
       return;
     }
     blob_index.EncodeTo(&index_entry);
+    if (!ctx->cache_record.empty()) {
+      // The record is cached under its new location before the new index
+      // is written, so that the reads following the rewrite hit.
+      InsertBlobCache(blob_gc_->titan_cf_options().blob_cache.get(),
+                      BlobCacheKey(blob_file_set_->blob_cache_id(),
+                                   blob_index.file_number,
+                                   blob_index.blob_handle.offset),
+                      ctx->cache_record);
+    }
     // Store WriteBatch for rewriting new Key-Index pairs to LSM
     GarbageCollectionWriteCallback callback(cfh, ikey.user_key.ToString(),
                                             original_index, blob_index);
@@ -346,6 +361,15 @@ void BlobGCJob::BatchWriteNewIndices(BlobFileBuilder::OutContexts& contexts,
   }
 }
 
+bool BlobGCJob::ShouldFillBlobCache(const BlobIndex& blob_index) {
+  const auto& cf_options = blob_gc_->titan_cf_options();
+  return cf_options.blob_cache && cf_options.blob_cache_fill_on_gc &&
+         IsBlobCached(cf_options.blob_cache.get(),
+                      BlobCacheKey(blob_file_set_->blob_cache_id(),
+                                   blob_index.file_number,
+                                   blob_index.blob_handle.offset));
+}
+
 Status BlobGCJob::BuildIterator(
     std::unique_ptr<BlobFileMergeIterator>* result) {
   Status s;
@@ -362,7 +386,8 @@ Status BlobGCJob::BuildIterator(
     }
     list.emplace_back(std::unique_ptr<BlobFileIterator>(new BlobFileIterator(
         std::move(file), inputs[i]->file_number(), inputs[i]->file_size(),
-        blob_gc_->titan_cf_options())));
+        blob_gc_->titan_cf_options(), blob_file_set_->blob_cache_id(),
+        env_options_.rate_limiter)));
   }
 
   if (s.ok())
@@ -22,7 +22,8 @@ class BlobGCJob {
             const TitanDBOptions &titan_db_options, Env *env,
             const EnvOptions &env_options, BlobFileManager *blob_file_manager,
             BlobFileSet *blob_file_set, LogBuffer *log_buffer,
-            std::atomic_bool *shuting_down, TitanStats *stats);
+            std::atomic_bool *shuting_down, TitanStats *stats,
+            ThreadPool *compression_pool);
 
   // No copying allowed
   BlobGCJob(const BlobGCJob &) = delete;
@@ -64,6 +65,9 @@ class BlobGCJob {
 
   TitanStats *stats_;
 
+  // Runs the parallel compression of the output files, see BlobFileBuilder.
+  ThreadPool *compression_pool_;
+
   struct {
     uint64_t gc_bytes_read = 0;
     uint64_t gc_bytes_written = 0;
@@ -86,6 +90,9 @@ class BlobGCJob {
 
   Status DoRunGC();
   void BatchWriteNewIndices(BlobFileBuilder::OutContexts &contexts, Status *s);
+  // Returns whether the record relocated from "blob_index" should be
+  // inserted into the blob cache under its new location.
+  bool ShouldFillBlobCache(const BlobIndex &blob_index);
   Status BuildIterator(std::unique_ptr<BlobFileMergeIterator> *result);
   Status DiscardEntry(const Slice &key, const BlobIndex &blob_index,
                       bool *discardable);
@@ -39,12 +39,16 @@ class BlobGCPickerTest : public testing::Test {
     if (being_gc) {
       f->FileStateTransit(BlobFileMeta::FileEvent::kGCBegin);
     }
+    MutexLock l(&blob_storage_->mutex_);
     blob_storage_->files_[file_number] = f;
+    blob_storage_->PublishFilesLocked();
   }
 
   void RemoveBlobFile(uint64_t file_number) {
+    MutexLock l(&blob_storage_->mutex_);
     ASSERT_TRUE(blob_storage_->files_[file_number] != nullptr);
     blob_storage_->files_.erase(file_number);
+    blob_storage_->PublishFilesLocked();
   }
 
   void UpdateBlobStorage() { blob_storage_->ComputeGCScore(); }
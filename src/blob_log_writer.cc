@@ -0,0 +1,71 @@
+#include "blob_log_writer.h"
+
+namespace rocksdb {
+namespace titandb {
+
+BlobLogWriter::BlobLogWriter(const TitanCFOptions& cf_options, uint32_t cf_id,
+                             std::unique_ptr<BlobFileHandle>&& handle)
+    : cf_options_(cf_options),
+      handle_(std::move(handle)),
+      encoder_(cf_options.blob_file_compression,
+               cf_options.blob_file_compression_options) {
+  encoder_.SetValueChunkSize(cf_options.blob_value_chunk_size);
+  BlobFileHeader header;
+  header.version = BlobFileHeader::kVersion2;
+  header.flags |= BlobFileHeader::kBlobLog;
+  header.column_family_id = cf_id;
+  std::string buffer;
+  header.EncodeTo(&buffer);
+  status_ = handle_->GetFile()->Append(buffer);
+}
+
+void BlobLogWriter::Add(const BlobRecord& record, BlobHandle* handle) {
+  if (!ok()) return;
+  encoder_.EncodeRecord(record);
+  WritableFileWriter* file = handle_->GetFile();
+  handle->offset = file->GetFileSize();
+  handle->size = encoder_.GetEncodedSize();
+  handle->order = num_entries_;
+
+  status_ = file->Append(encoder_.GetHeader());
+  if (ok()) {
+    status_ = file->Append(encoder_.GetRecord());
+  }
+  if (!ok()) return;
+
+  num_entries_++;
+  live_data_size_ += handle->size;
+  const Comparator* cmp = cf_options_.comparator;
+  if (num_entries_ == 1 || cmp->Compare(record.key, smallest_key_) < 0) {
+    smallest_key_.assign(record.key.data(), record.key.size());
+  }
+  if (num_entries_ == 1 || cmp->Compare(record.key, largest_key_) > 0) {
+    largest_key_.assign(record.key.data(), record.key.size());
+  }
+}
+
+Status BlobLogWriter::Flush(bool sync) {
+  if (!ok()) return status_;
+  status_ = handle_->GetFile()->Flush();
+  if (ok() && sync) {
+    status_ = handle_->GetFile()->Sync(false /*use_fsync*/);
+  }
+  return status_;
+}
+
+Status BlobLogWriter::Sync() {
+  return handle_->GetFile()->SyncWithoutFlush(false /*use_fsync*/);
+}
+
+std::shared_ptr<BlobFileMeta> BlobLogWriter::NewSealedMeta() const {
+  auto file = std::make_shared<BlobFileMeta>(
+      handle_->GetNumber(), handle_->GetFile()->GetFileSize(), num_entries_,
+      0 /*file_level*/, smallest_key_, largest_key_);
+  file->set_live_data_size(live_data_size_);
+  file->InitLiveDataBitset(num_entries_);
+  file->FileStateTransit(BlobFileMeta::FileEvent::kBlobLogSealed);
+  return file;
+}
+
+}  // namespace titandb
+}  // namespace rocksdb
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "blob_file_manager.h"
+#include "blob_format.h"
+#include "titan/options.h"
+
+namespace rocksdb {
+namespace titandb {
+
+// Blob log format:
+//
+// <begin>
+// [blob file header]
+// [blob record 1]
+// [blob record 2]
+// ...
+// [blob record N]
+// <end>
+//
+// A blob log holds the values separated on write, see
+// `TitanCFOptions::separate_blob_on_write`. Unlike a blob file built by
+// BlobFileBuilder, the records are in the order they are written, and
+// there are no meta blocks or footer, so the records can be read as soon
+// as they are flushed. The header has the `BlobFileHeader::kBlobLog` flag
+// and the column family id, so that a blob log not sealed before a crash
+// can be recovered by scanning the records.
+class BlobLogWriter {
+ public:
+  // Writes the header of the blob log of column family "cf_id" to the file
+  // of "handle".
+  BlobLogWriter(const TitanCFOptions& cf_options, uint32_t cf_id,
+                std::unique_ptr<BlobFileHandle>&& handle);
+
+  // Appends the record, and sets "*handle" to its location.
+  void Add(const BlobRecord& record, BlobHandle* handle);
+
+  // Flushes the records appended to the file, and syncs them if "sync".
+  Status Flush(bool sync);
+
+  // Syncs the records flushed to the file. Unlike Flush(), it can be
+  // called concurrently with Add() and Flush(), and returns NotSupported
+  // if the file can't be synced concurrently.
+  Status Sync();
+
+  // Returns non-ok iff some error has been detected.
+  Status status() const { return status_; }
+
+  uint64_t file_number() const { return handle_->GetNumber(); }
+
+  uint64_t file_size() const { return handle_->GetFile()->GetFileSize(); }
+
+  // Returns the meta of the sealed blob log, which counts all the records
+  // as live.
+  std::shared_ptr<BlobFileMeta> NewSealedMeta() const;
+
+  // Releases the file handle to finish the file.
+  std::unique_ptr<BlobFileHandle> ReleaseHandle() {
+    return std::move(handle_);
+  }
+
+ private:
+  bool ok() const { return status_.ok(); }
+
+  TitanCFOptions cf_options_;
+  std::unique_ptr<BlobFileHandle> handle_;
+  BlobEncoder encoder_;
+  Status status_;
+
+  uint64_t num_entries_{0};
+  uint64_t live_data_size_{0};
+  std::string smallest_key_;
+  std::string largest_key_;
+};
+
+}  // namespace titandb
+}  // namespace rocksdb
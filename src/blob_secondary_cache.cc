@@ -0,0 +1,444 @@
+#include "blob_secondary_cache.h"
+
+#ifndef __STDC_FORMAT_MACROS
+#define __STDC_FORMAT_MACROS
+#endif
+
+#include <algorithm>
+#include <cinttypes>
+
+#include "test_util/sync_point.h"
+#include "util/coding.h"
+#include "util/crc32c.h"
+#include "util/mutexlock.h"
+#include "util/string_util.h"
+
+namespace rocksdb {
+namespace titandb {
+
+namespace {
+
+const char* kCacheFileSuffix = ".blobcache";
+
+class BlobSecondaryCacheResultHandle : public SecondaryCacheResultHandle {
+ public:
+  BlobSecondaryCacheResultHandle(void* value, size_t size)
+      : value_(value), size_(size) {}
+
+  bool IsReady() override { return true; }
+
+  void Wait() override {}
+
+  void* Value() override { return value_; }
+
+  size_t Size() override { return size_; }
+
+ private:
+  void* value_;
+  size_t size_;
+};
+
+}  // namespace
+
+Status NewBlobSecondaryCache(const BlobSecondaryCacheOptions& options,
+                             std::shared_ptr<SecondaryCache>* result) {
+  return BlobSecondaryCache::Open(options, result);
+}
+
+Status BlobSecondaryCache::Open(const BlobSecondaryCacheOptions& options,
+                                std::shared_ptr<SecondaryCache>* result) {
+  if (options.path.empty()) {
+    return Status::InvalidArgument("blob secondary cache path is empty");
+  }
+  Status s = options.env->CreateDirIfMissing(options.path);
+  if (!s.ok()) {
+    return s;
+  }
+  std::shared_ptr<BlobSecondaryCache> cache(new BlobSecondaryCache(options));
+  s = cache->Recover();
+  if (!s.ok()) {
+    return s;
+  }
+  *result = cache;
+  return s;
+}
+
+BlobSecondaryCache::BlobSecondaryCache(const BlobSecondaryCacheOptions& options)
+    : options_(options),
+      env_(options.env),
+      bg_pool_(NewThreadPool(1)),
+      bg_cv_(&mutex_) {}
+
+BlobSecondaryCache::~BlobSecondaryCache() {
+  bg_pool_->WaitForJobsAndJoinAllThreads();
+  // Writes out the active file, so that its records are kept for the next
+  // open.
+  std::shared_ptr<CacheFile> active;
+  {
+    MutexLock l(&mutex_);
+    if (!files_.empty() && files_.back()->size > 0) {
+      active = files_.back();
+      active->writing = true;
+    }
+  }
+  if (active) {
+    WriteFile(active);
+  }
+}
+
+std::string BlobSecondaryCache::CacheFileName(uint64_t number) const {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "/%06" PRIu64 "%s", number, kCacheFileSuffix);
+  return options_.path + buf;
+}
+
+Status BlobSecondaryCache::Recover() {
+  std::vector<std::string> children;
+  Status s = env_->GetChildren(options_.path, &children);
+  if (!s.ok()) {
+    return s;
+  }
+  std::vector<uint64_t> numbers;
+  for (auto& name : children) {
+    Slice rest(name);
+    uint64_t number = 0;
+    if (ConsumeDecimalNumber(&rest, &number) && rest == kCacheFileSuffix) {
+      numbers.push_back(number);
+    }
+  }
+  // Only the newest files within the capacity are recovered, since the
+  // older ones would be evicted right away.
+  std::sort(numbers.rbegin(), numbers.rend());
+  std::vector<std::pair<uint64_t, uint64_t>> recovered_files;
+  uint64_t total_size = 0;
+  for (auto number : numbers) {
+    uint64_t file_size = 0;
+    s = env_->GetFileSize(CacheFileName(number), &file_size);
+    if (!s.ok()) {
+      return s;
+    }
+    if (total_size + file_size > options_.capacity) {
+      env_->DeleteFile(CacheFileName(number));
+      continue;
+    }
+    total_size += file_size;
+    recovered_files.emplace_back(number, file_size);
+  }
+  for (auto it = recovered_files.rbegin(); it != recovered_files.rend();
+       ++it) {
+    s = RecoverFile(it->first, it->second);
+    if (!s.ok()) {
+      return s;
+    }
+  }
+
+  std::vector<std::string> obsolete_files;
+  {
+    MutexLock l(&mutex_);
+    RollFileLocked();
+    obsolete_files = EvictLocked();
+  }
+  for (auto& file_name : obsolete_files) {
+    env_->DeleteFile(file_name);
+  }
+  return Status::OK();
+}
+
+Status BlobSecondaryCache::RecoverFile(uint64_t number, uint64_t file_size) {
+  std::string file_name = CacheFileName(number);
+  std::unique_ptr<SequentialFile> file;
+  Status s = env_->NewSequentialFile(file_name, &file, EnvOptions());
+  if (!s.ok()) {
+    return s;
+  }
+
+  // Only the headers and the keys are read, and the values are skipped.
+  // The checksum of a record is verified when it is looked up.
+  auto cache_file = std::make_shared<CacheFile>();
+  cache_file->number = number;
+  std::vector<std::pair<uint64_t, size_t>> locations;
+  char header[kHeaderSize];
+  std::string key_buf;
+  // The records after the first broken one are dropped, which happens if
+  // the file is not completely written out.
+  while (cache_file->size + kHeaderSize <= file_size) {
+    Slice data;
+    s = file->Read(kHeaderSize, &data, header);
+    if (!s.ok() || data.size() != kHeaderSize) {
+      break;
+    }
+    uint32_t key_size = DecodeFixed32(data.data());
+    uint32_t value_size = DecodeFixed32(data.data() + 4);
+    uint64_t record_size = kHeaderSize + static_cast<uint64_t>(key_size) +
+                           value_size + kTrailerSize;
+    if (record_size > options_.file_size ||
+        cache_file->size + record_size > file_size) {
+      break;
+    }
+    key_buf.resize(key_size);
+    s = file->Read(key_size, &data, &key_buf[0]);
+    if (!s.ok() || data.size() != key_size) {
+      break;
+    }
+    s = file->Skip(value_size + kTrailerSize);
+    if (!s.ok()) {
+      break;
+    }
+    cache_file->keys.emplace_back(data.data(), data.size());
+    locations.emplace_back(cache_file->size, record_size);
+    cache_file->size += record_size;
+  }
+  file.reset();
+  std::unique_ptr<RandomAccessFile> reader;
+  s = env_->NewRandomAccessFile(file_name, &reader, EnvOptions());
+  if (!s.ok()) {
+    return s;
+  }
+  cache_file->file = std::move(reader);
+
+  MutexLock l(&mutex_);
+  for (size_t i = 0; i < locations.size(); i++) {
+    index_[cache_file->keys[i]] =
+        Location{cache_file, locations[i].first, locations[i].second};
+  }
+  total_size_ += cache_file->size;
+  files_.push_back(cache_file);
+  next_file_number_ = std::max(next_file_number_, number + 1);
+  return Status::OK();
+}
+
+Status BlobSecondaryCache::WriteFile(const std::shared_ptr<CacheFile>& file) {
+  TEST_SYNC_POINT("BlobSecondaryCache::WriteFile");
+  // The buffer is not modified until it is cleared below, so it is safe to
+  // read it without the mutex.
+  std::string file_name = CacheFileName(file->number);
+  std::unique_ptr<WritableFile> writer;
+  Status s = env_->NewWritableFile(file_name, &writer, EnvOptions());
+  // The file is not synced, since the records are checked when the file
+  // is recovered and when they are looked up.
+  if (s.ok()) {
+    s = writer->Append(file->buffer);
+  }
+  if (s.ok()) {
+    s = writer->Close();
+  }
+  std::unique_ptr<RandomAccessFile> reader;
+  if (s.ok()) {
+    s = env_->NewRandomAccessFile(file_name, &reader, EnvOptions());
+  }
+  bool evicted = false;
+  {
+    MutexLock l(&mutex_);
+    file->writing = false;
+    evicted = file->evicted;
+    if (s.ok() && !evicted) {
+      file->file = std::move(reader);
+      std::string().swap(file->buffer);
+    }
+    // Otherwise the records are still served from the buffer.
+  }
+  if (evicted) {
+    reader.reset();
+    env_->DeleteFile(file_name);
+  }
+  return s;
+}
+
+void BlobSecondaryCache::Schedule(std::function<void()> job) {
+  {
+    MutexLock l(&mutex_);
+    bg_jobs_++;
+  }
+  bg_pool_->SubmitJob([this, job]() {
+    job();
+    MutexLock l(&mutex_);
+    bg_jobs_--;
+    bg_cv_.SignalAll();
+  });
+}
+
+void BlobSecondaryCache::WaitForBackgroundJobs() {
+  MutexLock l(&mutex_);
+  while (bg_jobs_ > 0) {
+    bg_cv_.Wait();
+  }
+}
+
+std::shared_ptr<BlobSecondaryCache::CacheFile>
+BlobSecondaryCache::RollFileLocked() {
+  mutex_.AssertHeld();
+  std::shared_ptr<CacheFile> full;
+  if (!files_.empty()) {
+    full = files_.back();
+  }
+  auto active = std::make_shared<CacheFile>();
+  active->number = next_file_number_++;
+  files_.push_back(active);
+  return full;
+}
+
+std::vector<std::string> BlobSecondaryCache::EvictLocked() {
+  mutex_.AssertHeld();
+  std::vector<std::string> obsolete_files;
+  // The active file is never dropped.
+  while (total_size_ > options_.capacity && files_.size() > 1) {
+    auto file = files_.front();
+    files_.pop_front();
+    for (auto& key : file->keys) {
+      auto it = index_.find(key);
+      if (it != index_.end() && it->second.file == file) {
+        index_.erase(it);
+      }
+    }
+    total_size_ -= file->size;
+    if (file->writing) {
+      // Deleted by the writer, which may not have created it yet.
+      file->evicted = true;
+    } else {
+      obsolete_files.emplace_back(CacheFileName(file->number));
+    }
+  }
+  return obsolete_files;
+}
+
+Status BlobSecondaryCache::DecodeRecord(const Slice& data, Slice* key,
+                                        Slice* value) {
+  if (data.size() < kHeaderSize + kTrailerSize) {
+    return Status::Corruption("blob secondary cache record too short");
+  }
+  uint32_t key_size = DecodeFixed32(data.data());
+  uint32_t value_size = DecodeFixed32(data.data() + 4);
+  size_t payload_size = static_cast<size_t>(key_size) + value_size;
+  if (data.size() != kHeaderSize + payload_size + kTrailerSize) {
+    return Status::Corruption("blob secondary cache record size mismatch");
+  }
+  const char* payload = data.data() + kHeaderSize;
+  uint32_t crc = crc32c::Unmask(DecodeFixed32(payload + payload_size));
+  if (crc != crc32c::Value(payload, payload_size)) {
+    return Status::Corruption("blob secondary cache record checksum mismatch");
+  }
+  *key = Slice(payload, key_size);
+  *value = Slice(payload + key_size, value_size);
+  return Status::OK();
+}
+
+Status BlobSecondaryCache::Insert(const Slice& key, void* value,
+                                  const Cache::CacheItemHelper* helper) {
+  size_t value_size = helper->size_cb(value);
+  size_t record_size = kHeaderSize + key.size() + value_size + kTrailerSize;
+  if (record_size > options_.file_size) {
+    return Status::OK();
+  }
+  std::string record;
+  record.resize(record_size);
+  char* dst = &record[0];
+  EncodeFixed32(dst, static_cast<uint32_t>(key.size()));
+  EncodeFixed32(dst + 4, static_cast<uint32_t>(value_size));
+  memcpy(dst + kHeaderSize, key.data(), key.size());
+  Status s =
+      helper->saveto_cb(value, 0, value_size, dst + kHeaderSize + key.size());
+  if (!s.ok()) {
+    return s;
+  }
+  size_t payload_size = key.size() + value_size;
+  EncodeFixed32(dst + kHeaderSize + payload_size,
+                crc32c::Mask(crc32c::Value(dst + kHeaderSize, payload_size)));
+
+  std::shared_ptr<CacheFile> full;
+  std::vector<std::string> obsolete_files;
+  {
+    MutexLock l(&mutex_);
+    auto active = files_.back();
+    if (active->size + record_size > options_.file_size) {
+      full = RollFileLocked();
+      full->writing = true;
+      active = files_.back();
+    }
+    index_[key.ToString()] = Location{active, active->size, record_size};
+    active->keys.emplace_back(key.ToString());
+    active->buffer.append(record);
+    active->size += record_size;
+    total_size_ += record_size;
+    obsolete_files = EvictLocked();
+  }
+  if (full) {
+    // Lookups read its records from the buffer until it is written out.
+    Schedule([this, full]() { WriteFile(full); });
+  }
+  if (!obsolete_files.empty()) {
+    Schedule([this, obsolete_files]() {
+      for (auto& file_name : obsolete_files) {
+        env_->DeleteFile(file_name);
+      }
+    });
+  }
+  return s;
+}
+
+std::unique_ptr<SecondaryCacheResultHandle> BlobSecondaryCache::Lookup(
+    const Slice& key, const Cache::CreateCallback& create_cb, bool /*wait*/) {
+  std::unique_ptr<SecondaryCacheResultHandle> result;
+  Location location;
+  std::string scratch;
+  Slice data;
+  {
+    MutexLock l(&mutex_);
+    auto it = index_.find(key.ToString());
+    if (it == index_.end()) {
+      return result;
+    }
+    location = it->second;
+    if (!location.file->file) {
+      // The record is still in the buffer of the file.
+      scratch.assign(location.file->buffer.data() + location.offset,
+                     location.size);
+      data = scratch;
+    }
+  }
+  if (data.empty()) {
+    // A written out file is never modified, so it is read without the
+    // mutex.
+    scratch.resize(location.size);
+    Status s = location.file->file->Read(location.offset, location.size,
+                                         &data, &scratch[0]);
+    if (!s.ok() || data.size() != location.size) {
+      return result;
+    }
+  }
+
+  Slice record_key, value;
+  if (!DecodeRecord(data, &record_key, &value).ok() || record_key != key) {
+    Erase(key);
+    return result;
+  }
+  void* obj = nullptr;
+  size_t charge = 0;
+  Status s = create_cb(const_cast<char*>(value.data()), value.size(), &obj,
+                       &charge);
+  if (s.ok()) {
+    result.reset(new BlobSecondaryCacheResultHandle(obj, charge));
+  }
+  return result;
+}
+
+void BlobSecondaryCache::Erase(const Slice& key) {
+  MutexLock l(&mutex_);
+  index_.erase(key.ToString());
+}
+
+std::string BlobSecondaryCache::GetPrintableOptions() const {
+  char buf[256];
+  snprintf(buf, sizeof(buf),
+           "    path: %s\n    capacity: %" PRIu64 "\n    file_size: %" PRIu64
+           "\n",
+           options_.path.c_str(), options_.capacity, options_.file_size);
+  return buf;
+}
+
+uint64_t BlobSecondaryCache::GetUsage() {
+  MutexLock l(&mutex_);
+  return total_size_;
+}
+
+}  // namespace titandb
+}  // namespace rocksdb
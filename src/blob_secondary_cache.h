@@ -0,0 +1,133 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <unordered_map>
+
+#include "port/port.h"
+#include "rocksdb/env.h"
+#include "rocksdb/secondary_cache.h"
+#include "rocksdb/threadpool.h"
+#include "titan/secondary_cache.h"
+
+namespace rocksdb {
+namespace titandb {
+
+// A secondary cache of blob records stored in append-only cache files.
+//
+// Inserted records are appended to an in-memory active file. When it is
+// full, a new active file is started, and the full one is written out by a
+// background thread, its records being served from memory meanwhile. When
+// the total size exceeds the capacity, the oldest cache file is dropped
+// along with the records in it. Each record is stored as:
+//
+//    +--------------+----------------+-------+---------+---------+
+//    | key size (4) | value size (4) |  key  |  value  | crc (4) |
+//    +--------------+----------------+-------+---------+---------+
+//
+// so that the index can be rebuilt from the cache files on open, and the
+// records are checked when they are looked up.
+class BlobSecondaryCache : public SecondaryCache {
+ public:
+  static Status Open(const BlobSecondaryCacheOptions& options,
+                     std::shared_ptr<SecondaryCache>* result);
+
+  ~BlobSecondaryCache() override;
+
+  const char* Name() const override { return "TitanBlobSecondaryCache"; }
+
+  Status Insert(const Slice& key, void* value,
+                const Cache::CacheItemHelper* helper) override;
+
+  std::unique_ptr<SecondaryCacheResultHandle> Lookup(
+      const Slice& key, const Cache::CreateCallback& create_cb,
+      bool wait) override;
+
+  void Erase(const Slice& key) override;
+
+  // Lookups are always completed synchronously.
+  void WaitAll(std::vector<SecondaryCacheResultHandle*> /*handles*/) override {
+  }
+
+  std::string GetPrintableOptions() const override;
+
+  // Returns the total size of the cached records.
+  uint64_t GetUsage();
+
+  // Waits until the full files are written out and the dropped ones are
+  // deleted.
+  void WaitForBackgroundJobs();
+
+ private:
+  static const size_t kHeaderSize = 8;
+  static const size_t kTrailerSize = 4;
+
+  struct CacheFile {
+    uint64_t number{0};
+    uint64_t size{0};
+    // The content of the active file, cleared after it is written out.
+    std::string buffer;
+    // Set after the file is written out.
+    std::unique_ptr<RandomAccessFile> file;
+    std::vector<std::string> keys;
+    // Set while the file is being written out. A file evicted meanwhile is
+    // deleted by the writer once it is written, instead of by the eviction.
+    bool writing{false};
+    bool evicted{false};
+  };
+
+  struct Location {
+    std::shared_ptr<CacheFile> file;
+    uint64_t offset;
+    size_t size;
+  };
+
+  explicit BlobSecondaryCache(const BlobSecondaryCacheOptions& options);
+
+  std::string CacheFileName(uint64_t number) const;
+
+  // Rebuilds the index from the existing cache files, reading only the
+  // headers and the keys of the records.
+  Status Recover();
+  Status RecoverFile(uint64_t number, uint64_t file_size);
+
+  // Writes out the content of "file" and opens it for reads, or deletes it
+  // if it is evicted meanwhile.
+  // REQUIRES: file->writing is set
+  Status WriteFile(const std::shared_ptr<CacheFile>& file);
+
+  // Runs "job" on the background thread.
+  void Schedule(std::function<void()> job);
+
+  // Starts a new active file. Returns the previous one to be written out.
+  // REQUIRES: mutex_ is held
+  std::shared_ptr<CacheFile> RollFileLocked();
+
+  // Drops the oldest cache files while the capacity is exceeded. Returns
+  // the names of the dropped files to be deleted, except those being
+  // written out.
+  // REQUIRES: mutex_ is held
+  std::vector<std::string> EvictLocked();
+
+  // Checks the record in "data" and returns its key and value.
+  static Status DecodeRecord(const Slice& data, Slice* key, Slice* value);
+
+  const BlobSecondaryCacheOptions options_;
+  Env* env_;
+
+  // Writes out the full files and deletes the dropped ones, so that
+  // inserts don't wait for file I/O.
+  std::unique_ptr<ThreadPool> bg_pool_;
+
+  port::Mutex mutex_;
+  port::CondVar bg_cv_;
+  int bg_jobs_{0};
+  std::unordered_map<std::string, Location> index_;
+  // Cache files in the order of creation, the last one is active.
+  std::deque<std::shared_ptr<CacheFile>> files_;
+  uint64_t total_size_{0};
+  uint64_t next_file_number_{1};
+};
+
+}  // namespace titandb
+}  // namespace rocksdb
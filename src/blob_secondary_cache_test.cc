@@ -0,0 +1,308 @@
+#include "blob_secondary_cache.h"
+
+#include "file/file_util.h"
+#include "file/filename.h"
+#include "rocksdb/cache.h"
+#include "test_util/sync_point.h"
+#include "test_util/testharness.h"
+
+#include "blob_file_builder.h"
+#include "blob_file_cache.h"
+#include "util.h"
+
+namespace rocksdb {
+namespace titandb {
+
+class BlobSecondaryCacheTest : public testing::Test {
+ public:
+  BlobSecondaryCacheTest() : dirname_(test::PerThreadDBPath(env_, "bsc")) {
+    env_->CreateDirIfMissing(dirname_);
+    options_.path = dirname_ + "/cache";
+    options_.env = env_;
+  }
+
+  ~BlobSecondaryCacheTest() { DestroyDir(env_, dirname_); }
+
+  static size_t SizeCallback(void* obj) {
+    return reinterpret_cast<std::string*>(obj)->size();
+  }
+
+  static Status SaveToCallback(void* from_obj, size_t from_offset,
+                               size_t length, void* out) {
+    auto value = reinterpret_cast<std::string*>(from_obj);
+    memcpy(out, value->data() + from_offset, length);
+    return Status::OK();
+  }
+
+  Status Insert(SecondaryCache* cache, const std::string& key,
+                std::string value) {
+    Cache::CacheItemHelper helper(SizeCallback, SaveToCallback,
+                                  DeleteCacheValue<std::string>);
+    return cache->Insert(key, &value, &helper);
+  }
+
+  // Returns the cached value or an empty string if not found.
+  std::string Lookup(SecondaryCache* cache, const std::string& key) {
+    auto create_cb = [](void* buf, size_t size, void** out_obj,
+                        size_t* charge) -> Status {
+      *out_obj = new std::string(reinterpret_cast<char*>(buf), size);
+      *charge = size;
+      return Status::OK();
+    };
+    auto handle = cache->Lookup(key, create_cb, true /*wait*/);
+    if (!handle) {
+      return "";
+    }
+    EXPECT_TRUE(handle->IsReady());
+    std::unique_ptr<std::string> value(
+        reinterpret_cast<std::string*>(handle->Value()));
+    EXPECT_EQ(value->size(), handle->Size());
+    return *value;
+  }
+
+  Env* env_{Env::Default()};
+  std::string dirname_;
+  BlobSecondaryCacheOptions options_;
+};
+
+TEST_F(BlobSecondaryCacheTest, Basic) {
+  std::shared_ptr<SecondaryCache> cache;
+  options_.file_size = 4 << 10;
+  ASSERT_OK(NewBlobSecondaryCache(options_, &cache));
+
+  const int n = 100;
+  for (int i = 0; i < n; i++) {
+    ASSERT_OK(Insert(cache.get(), std::to_string(i),
+                     std::string(100, 'a' + i % 26)));
+  }
+  for (int i = 0; i < n; i++) {
+    ASSERT_EQ(std::string(100, 'a' + i % 26),
+              Lookup(cache.get(), std::to_string(i)));
+  }
+  ASSERT_EQ("", Lookup(cache.get(), std::to_string(n)));
+
+  cache->Erase(std::to_string(0));
+  ASSERT_EQ("", Lookup(cache.get(), std::to_string(0)));
+}
+
+TEST_F(BlobSecondaryCacheTest, Capacity) {
+  std::shared_ptr<SecondaryCache> cache;
+  options_.file_size = 4 << 10;
+  options_.capacity = 16 << 10;
+  ASSERT_OK(NewBlobSecondaryCache(options_, &cache));
+  auto blob_cache = static_cast<BlobSecondaryCache*>(cache.get());
+
+  const int n = 1000;
+  for (int i = 0; i < n; i++) {
+    ASSERT_OK(Insert(cache.get(), std::to_string(i), std::string(100, 'a')));
+    ASSERT_LE(blob_cache->GetUsage(), options_.capacity);
+  }
+  // The oldest records are dropped, the newest ones are kept.
+  ASSERT_EQ("", Lookup(cache.get(), std::to_string(0)));
+  ASSERT_EQ(std::string(100, 'a'), Lookup(cache.get(), std::to_string(n - 1)));
+
+  blob_cache->WaitForBackgroundJobs();
+  std::vector<std::string> children;
+  ASSERT_OK(env_->GetChildren(options_.path, &children));
+  uint64_t total_size = 0;
+  for (auto& name : children) {
+    uint64_t size = 0;
+    if (env_->GetFileSize(options_.path + "/" + name, &size).ok()) {
+      total_size += size;
+    }
+  }
+  ASSERT_LE(total_size, options_.capacity);
+}
+
+TEST_F(BlobSecondaryCacheTest, EvictFileBeingWritten) {
+  std::shared_ptr<SecondaryCache> cache;
+  options_.file_size = 4 << 10;
+  // A full file is evicted by the insert which rolls it, before it is
+  // written out.
+  options_.capacity = options_.file_size;
+  ASSERT_OK(NewBlobSecondaryCache(options_, &cache));
+  auto blob_cache = static_cast<BlobSecondaryCache*>(cache.get());
+  for (int i = 0; i < 1000; i++) {
+    ASSERT_OK(Insert(cache.get(), std::to_string(i), std::string(100, 'a')));
+  }
+  blob_cache->WaitForBackgroundJobs();
+  std::vector<std::string> children;
+  ASSERT_OK(env_->GetChildren(options_.path, &children));
+  for (auto& name : children) {
+    ASSERT_FALSE(Slice(name).ends_with(".blobcache")) << name;
+  }
+  uint64_t usage = blob_cache->GetUsage();
+  ASSERT_LE(usage, options_.capacity);
+
+  cache.reset();
+  ASSERT_OK(NewBlobSecondaryCache(options_, &cache));
+  blob_cache = static_cast<BlobSecondaryCache*>(cache.get());
+  ASSERT_EQ(usage, blob_cache->GetUsage());
+  ASSERT_EQ(std::string(100, 'a'), Lookup(cache.get(), std::to_string(999)));
+}
+
+TEST_F(BlobSecondaryCacheTest, LookupFileBeingWritten) {
+  std::shared_ptr<SecondaryCache> cache;
+  options_.file_size = 4 << 10;
+  ASSERT_OK(NewBlobSecondaryCache(options_, &cache));
+  auto blob_cache = static_cast<BlobSecondaryCache*>(cache.get());
+
+  // Holds the background write until the records of the full file are
+  // looked up.
+  SyncPoint::GetInstance()->LoadDependency(
+      {{"BlobSecondaryCacheTest::LookupFileBeingWritten:Done",
+        "BlobSecondaryCache::WriteFile"}});
+  SyncPoint::GetInstance()->EnableProcessing();
+  const int n = 50;
+  for (int i = 0; i < n; i++) {
+    ASSERT_OK(Insert(cache.get(), std::to_string(i),
+                     std::string(100, 'a' + i % 26)));
+  }
+  for (int i = 0; i < n; i++) {
+    ASSERT_EQ(std::string(100, 'a' + i % 26),
+              Lookup(cache.get(), std::to_string(i)));
+  }
+  TEST_SYNC_POINT("BlobSecondaryCacheTest::LookupFileBeingWritten:Done");
+  blob_cache->WaitForBackgroundJobs();
+  SyncPoint::GetInstance()->DisableProcessing();
+  SyncPoint::GetInstance()->ClearAllCallBacks();
+
+  for (int i = 0; i < n; i++) {
+    ASSERT_EQ(std::string(100, 'a' + i % 26),
+              Lookup(cache.get(), std::to_string(i)));
+  }
+}
+
+TEST_F(BlobSecondaryCacheTest, Reopen) {
+  const int n = 100;
+  {
+    std::shared_ptr<SecondaryCache> cache;
+    options_.file_size = 4 << 10;
+    ASSERT_OK(NewBlobSecondaryCache(options_, &cache));
+    for (int i = 0; i < n; i++) {
+      ASSERT_OK(Insert(cache.get(), std::to_string(i),
+                       std::string(100, 'a' + i % 26)));
+    }
+  }
+  std::shared_ptr<SecondaryCache> cache;
+  ASSERT_OK(NewBlobSecondaryCache(options_, &cache));
+  for (int i = 0; i < n; i++) {
+    ASSERT_EQ(std::string(100, 'a' + i % 26),
+              Lookup(cache.get(), std::to_string(i)));
+  }
+}
+
+TEST_F(BlobSecondaryCacheTest, ReopenWithSmallerCapacity) {
+  const int n = 200;
+  options_.file_size = 4 << 10;
+  {
+    std::shared_ptr<SecondaryCache> cache;
+    ASSERT_OK(NewBlobSecondaryCache(options_, &cache));
+    for (int i = 0; i < n; i++) {
+      ASSERT_OK(Insert(cache.get(), std::to_string(i),
+                       std::string(100, 'a' + i % 26)));
+    }
+  }
+  // Only the newest files within the capacity are recovered, and the
+  // others are deleted.
+  options_.capacity = 8 << 10;
+  std::shared_ptr<SecondaryCache> cache;
+  ASSERT_OK(NewBlobSecondaryCache(options_, &cache));
+  auto blob_cache = static_cast<BlobSecondaryCache*>(cache.get());
+  ASSERT_LE(blob_cache->GetUsage(), options_.capacity);
+  ASSERT_EQ("", Lookup(cache.get(), std::to_string(0)));
+  ASSERT_EQ(std::string(100, 'a' + (n - 1) % 26),
+            Lookup(cache.get(), std::to_string(n - 1)));
+  std::vector<std::string> children;
+  ASSERT_OK(env_->GetChildren(options_.path, &children));
+  uint64_t total_size = 0;
+  for (auto& name : children) {
+    uint64_t size = 0;
+    if (env_->GetFileSize(options_.path + "/" + name, &size).ok()) {
+      total_size += size;
+    }
+  }
+  ASSERT_LE(total_size, options_.capacity);
+}
+
+TEST_F(BlobSecondaryCacheTest, BlobCache) {
+  std::shared_ptr<SecondaryCache> secondary_cache;
+  ASSERT_OK(NewBlobSecondaryCache(options_, &secondary_cache));
+  LRUCacheOptions cache_options;
+  // Holds only a few records, the rest are spilled to the secondary cache.
+  cache_options.capacity = 4 << 10;
+  cache_options.num_shard_bits = 0;
+  cache_options.secondary_cache = secondary_cache;
+
+  TitanOptions options;
+  options.dirname = dirname_;
+  options.blob_cache = NewLRUCache(cache_options);
+  TitanDBOptions db_options(options);
+  TitanCFOptions cf_options(options);
+  EnvOptions env_options(db_options);
+
+  const uint64_t file_number = 1;
+  const int n = 100;
+  std::string file_name = BlobFileName(dirname_, file_number);
+  BlobFileBuilder::OutContexts contexts;
+  {
+    std::unique_ptr<FSWritableFile> f;
+    ASSERT_OK(env_->GetFileSystem()->NewWritableFile(
+        file_name, FileOptions(env_options), &f, nullptr /*dbg*/));
+    WritableFileWriter file(std::move(f), file_name,
+                            FileOptions(env_options));
+    BlobFileBuilder builder(db_options, cf_options, &file);
+    for (int i = 0; i < n; i++) {
+      std::string key = std::to_string(i);
+      std::string value(1024, 'a' + i % 26);
+      BlobRecord record;
+      record.key = key;
+      record.value = value;
+      std::unique_ptr<BlobFileBuilder::BlobRecordContext> ctx(
+          new BlobFileBuilder::BlobRecordContext);
+      ctx->key = key;
+      BlobFileBuilder::OutContexts cur_contexts;
+      builder.Add(record, std::move(ctx), &cur_contexts);
+      for (auto& c : cur_contexts) {
+        contexts.emplace_back(std::move(c));
+      }
+    }
+    BlobFileBuilder::OutContexts cur_contexts;
+    ASSERT_OK(builder.Finish(&cur_contexts));
+    for (auto& c : cur_contexts) {
+      contexts.emplace_back(std::move(c));
+    }
+  }
+  ASSERT_EQ(static_cast<size_t>(n), contexts.size());
+  uint64_t file_size = 0;
+  ASSERT_OK(env_->GetFileSize(file_name, &file_size));
+
+  BlobFileCache file_cache(db_options, cf_options, {NewLRUCache(128)},
+                           nullptr);
+  auto read_all = [&]() {
+    for (int i = 0; i < n; i++) {
+      BlobRecord record;
+      PinnableSlice buffer;
+      ASSERT_OK(file_cache.Get(ReadOptions(), file_number, file_size,
+                               contexts[i]->new_blob_index.blob_handle,
+                               &record, &buffer));
+      ASSERT_EQ(std::string(1024, 'a' + i % 26), record.value.ToString());
+    }
+  };
+  read_all();
+  ASSERT_GT(static_cast<BlobSecondaryCache*>(secondary_cache.get())
+                ->GetUsage(),
+            0);
+
+  // Records evicted from the blob cache are read back from the secondary
+  // cache.
+  read_all();
+}
+
+}  // namespace titandb
+}  // namespace rocksdb
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -8,7 +8,7 @@ namespace titandb {
 
 Status BlobStorage::Get(const ReadOptions& options, const BlobIndex& index,
                         BlobRecord* record, PinnableSlice* buffer) {
-  auto sfile = FindFile(index.file_number).lock();
+  auto sfile = FindReadableFile(index.file_number);
   if (!sfile)
     return Status::Corruption("Missing blob file: " +
                               std::to_string(index.file_number));
@@ -16,9 +16,82 @@ Status BlobStorage::Get(const ReadOptions& options, const BlobIndex& index,
                           index.blob_handle, record, buffer);
 }
 
+Status BlobStorage::GetRange(const ReadOptions& options,
+                             const BlobIndex& index, const Slice& key,
+                             uint64_t offset, uint64_t length,
+                             PinnableSlice* value) {
+  auto sfile = FindReadableFile(index.file_number);
+  if (!sfile)
+    return Status::Corruption("Missing blob file: " +
+                              std::to_string(index.file_number));
+  return file_cache_->GetRange(options, sfile->file_number(),
+                               sfile->file_size(), index.blob_handle, key,
+                               offset, length, value);
+}
+
+Status BlobStorage::GetChunks(
+    const ReadOptions& options, const BlobIndex& index, const Slice& key,
+    size_t chunk_size, const std::function<bool(const Slice&)>& callback) {
+  auto sfile = FindReadableFile(index.file_number);
+  if (!sfile)
+    return Status::Corruption("Missing blob file: " +
+                              std::to_string(index.file_number));
+  return file_cache_->GetChunks(options, sfile->file_number(),
+                                sfile->file_size(), index.blob_handle, key,
+                                chunk_size, callback);
+}
+
+Status BlobStorage::LoadIntoCache(uint64_t file_number, uint64_t offset,
+                                  RateLimiter* rate_limiter) {
+  auto sfile = FindReadableFile(file_number);
+  if (!sfile)
+    return Status::Corruption("Missing blob file: " +
+                              std::to_string(file_number));
+  return file_cache_->LoadIntoCache(sfile->file_number(), sfile->file_size(),
+                                    offset, rate_limiter);
+}
+
+void BlobStorage::MultiGet(const ReadOptions& options,
+                           const std::vector<BlobIndex>& indexes,
+                           std::vector<BlobRecord>* records,
+                           std::vector<PinnableSlice>* buffers,
+                           std::vector<Status>* statuses) {
+  records->resize(indexes.size());
+  buffers->resize(indexes.size());
+  statuses->resize(indexes.size());
+
+  // file_number -> requests
+  std::map<uint64_t, std::vector<BlobReadRequest>> file_requests;
+  for (size_t i = 0; i < indexes.size(); i++) {
+    BlobReadRequest request;
+    request.handle = indexes[i].blob_handle;
+    request.record = &(*records)[i];
+    request.buffer = &(*buffers)[i];
+    request.status = &(*statuses)[i];
+    file_requests[indexes[i].file_number].emplace_back(request);
+  }
+
+  for (auto& file : file_requests) {
+    auto sfile = FindReadableFile(file.first);
+    Status s;
+    if (!sfile) {
+      s = Status::Corruption("Missing blob file: " +
+                             std::to_string(file.first));
+    } else {
+      s = file_cache_->MultiGet(options, sfile->file_number(),
+                                sfile->file_size(), &file.second);
+    }
+    if (!s.ok()) {
+      for (auto& request : file.second) {
+        *request.status = s;
+      }
+    }
+  }
+}
+
 Status BlobStorage::NewPrefetcher(uint64_t file_number,
                                   std::unique_ptr<BlobFilePrefetcher>* result) {
-  auto sfile = FindFile(file_number).lock();
+  auto sfile = FindReadableFile(file_number);
   if (!sfile)
     return Status::Corruption("Missing blob wfile: " +
                               std::to_string(file_number));
@@ -69,16 +142,58 @@ Status BlobStorage::GetBlobFilesInRanges(const RangePtr* ranges, size_t n,
   return Status::OK();
 }
 
-std::weak_ptr<BlobFileMeta> BlobStorage::FindFile(uint64_t file_number) const {
+void BlobStorage::GetBlobFilesOverlapping(const Slice* begin,
+                                          const Slice& end,
+                                          std::vector<uint64_t>* files) {
   MutexLock l(&mutex_);
-  auto it = files_.find(file_number);
-  if (it != files_.end()) {
+  auto cmp = cf_options_.comparator;
+  // Files starting at or after "end" don't overlap the range.
+  for (auto it = blob_ranges_.begin(); it != blob_ranges_.lower_bound(end);
+       it++) {
+    if (it->second->is_obsolete()) continue;
+    if (it->second->largest_key().empty() || begin == nullptr ||
+        cmp->Compare(it->second->largest_key(), *begin) >= 0) {
+      files->push_back(it->second->file_number());
+    }
+  }
+}
+
+std::weak_ptr<BlobFileMeta> BlobStorage::FindFile(uint64_t file_number) const {
+  auto files = std::atomic_load(&published_files_);
+  auto it = files->find(file_number);
+  if (it != files->end()) {
     assert(file_number == it->second->file_number());
     return it->second;
   }
   return std::weak_ptr<BlobFileMeta>();
 }
 
+std::shared_ptr<BlobFileMeta> BlobStorage::FindReadableFile(
+    uint64_t file_number) const {
+  auto logs = std::atomic_load(&published_blob_logs_);
+  auto it = logs->find(file_number);
+  if (it != logs->end()) {
+    return it->second;
+  }
+  return FindFile(file_number).lock();
+}
+
+void BlobStorage::AddBlobLog(const std::shared_ptr<BlobFileMeta>& file) {
+  MutexLock l(&mutex_);
+  auto logs = std::make_shared<FileMap>(*published_blob_logs_);
+  logs->emplace(file->file_number(), file);
+  std::atomic_store(&published_blob_logs_,
+                    std::shared_ptr<const FileMap>(std::move(logs)));
+}
+
+void BlobStorage::RemoveBlobLog(uint64_t file_number) {
+  MutexLock l(&mutex_);
+  auto logs = std::make_shared<FileMap>(*published_blob_logs_);
+  logs->erase(file_number);
+  std::atomic_store(&published_blob_logs_,
+                    std::shared_ptr<const FileMap>(std::move(logs)));
+}
+
 void BlobStorage::ExportBlobFiles(
     std::map<uint64_t, std::weak_ptr<BlobFileMeta>>& ret) const {
   ret.clear();
@@ -90,6 +205,22 @@ void BlobStorage::ExportBlobFiles(
 
 void BlobStorage::AddBlobFile(std::shared_ptr<BlobFileMeta>& file) {
   MutexLock l(&mutex_);
+  AddBlobFileLocked(file);
+  PublishFilesLocked();
+}
+
+void BlobStorage::AddBlobFiles(
+    const std::vector<std::shared_ptr<BlobFileMeta>>& files) {
+  if (files.empty()) return;
+  MutexLock l(&mutex_);
+  for (auto& file : files) {
+    AddBlobFileLocked(file);
+  }
+  PublishFilesLocked();
+}
+
+void BlobStorage::AddBlobFileLocked(const std::shared_ptr<BlobFileMeta>& file) {
+  mutex_.AssertHeld();
   files_.emplace(std::make_pair(file->file_number(), file));
   blob_ranges_.emplace(std::make_pair(Slice(file->smallest_key()), file));
   levels_file_count_[file->file_level()]++;
@@ -159,10 +290,18 @@ bool BlobStorage::RemoveFile(uint64_t file_number) {
   return true;
 }
 
+void BlobStorage::PublishFilesLocked() {
+  mutex_.AssertHeld();
+  std::shared_ptr<const FileMap> files = std::make_shared<FileMap>(files_);
+  std::atomic_store(&published_files_, files);
+}
+
 void BlobStorage::GetObsoleteFiles(std::vector<std::string>* obsolete_files,
                                    SequenceNumber oldest_sequence) {
   MutexLock l(&mutex_);
 
+  bool removed_any = false;
+
   for (auto it = obsolete_files_.begin(); it != obsolete_files_.end();) {
     auto& file_number = it->first;
     auto& obsolete_sequence = it->second;
@@ -173,6 +312,7 @@ void BlobStorage::GetObsoleteFiles(std::vector<std::string>* obsolete_files,
       // remove obsolete files
       bool __attribute__((__unused__)) removed = RemoveFile(file_number);
       assert(removed);
+      removed_any = true;
       TITAN_LOG_INFO(db_options_.info_log,
                      "Obsolete blob file %" PRIu64 " (obsolete at %" PRIu64
                      ") not visible to oldest snapshot %" PRIu64 ", delete it.",
@@ -187,6 +327,9 @@ void BlobStorage::GetObsoleteFiles(std::vector<std::string>* obsolete_files,
     }
     ++it;
   }
+  if (removed_any) {
+    PublishFilesLocked();
+  }
 }
 
 void BlobStorage::GetAllFiles(std::vector<std::string>* files) {
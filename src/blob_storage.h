@@ -20,6 +20,8 @@ class BlobStorage {
  public:
   BlobStorage(const BlobStorage& bs) : destroyed_(false) {
     this->files_ = bs.files_;
+    this->published_files_ = std::atomic_load(&bs.published_files_);
+    this->published_blob_logs_ = std::atomic_load(&bs.published_blob_logs_);
     this->file_cache_ = bs.file_cache_;
     this->db_options_ = bs.db_options_;
     this->cf_options_ = bs.cf_options_;
@@ -37,6 +39,8 @@ class BlobStorage {
         levels_file_count_(_cf_options.num_levels, 0),
         blob_ranges_(InternalComparator(_cf_options.comparator)),
         file_cache_(_file_cache),
+        published_files_(std::make_shared<FileMap>()),
+        published_blob_logs_(std::make_shared<FileMap>()),
         destroyed_(false),
         stats_(stats) {}
 
@@ -65,6 +69,33 @@ class BlobStorage {
   Status Get(const ReadOptions& options, const BlobIndex& index,
              BlobRecord* record, PinnableSlice* buffer);
 
+  // Gets the blob records pointed by the blob indexes in batch. The
+  // records are grouped by file and read in offset order. "records",
+  // "buffers" and "statuses" are resized to the number of indexes, and
+  // the buffers must be valid when the records are used.
+  void MultiGet(const ReadOptions& options,
+                const std::vector<BlobIndex>& indexes,
+                std::vector<BlobRecord>* records,
+                std::vector<PinnableSlice>* buffers,
+                std::vector<Status>* statuses);
+
+  // Gets up to "length" bytes of the value of "key" pointed by the blob
+  // index, starting at "offset" of the value. See BlobFileReader::GetRange.
+  Status GetRange(const ReadOptions& options, const BlobIndex& index,
+                  const Slice& key, uint64_t offset, uint64_t length,
+                  PinnableSlice* value);
+
+  // Reads the value of "key" pointed by the blob index in chunks. See
+  // BlobFileReader::GetChunks.
+  Status GetChunks(const ReadOptions& options, const BlobIndex& index,
+                   const Slice& key, size_t chunk_size,
+                   const std::function<bool(const Slice&)>& callback);
+
+  // Reads the record at "offset" of the specified file number into the
+  // blob cache. See BlobFileReader::LoadIntoCache.
+  Status LoadIntoCache(uint64_t file_number, uint64_t offset,
+                       RateLimiter* rate_limiter);
+
   // Creates a prefetcher for the specified file number.
   Status NewPrefetcher(uint64_t file_number,
                        std::unique_ptr<BlobFilePrefetcher>* result);
@@ -73,10 +104,23 @@ class BlobStorage {
   Status GetBlobFilesInRanges(const RangePtr* ranges, size_t n,
                               bool include_end, std::vector<uint64_t>* files);
 
+  // Gets the live blob files whose key ranges overlap [begin, end).
+  // nullptr "begin" means the minimum. Files of the old version without
+  // key ranges are always included.
+  void GetBlobFilesOverlapping(const Slice* begin, const Slice& end,
+                               std::vector<uint64_t>* files);
+
   // Finds the blob file meta for the specified file number. It is a
-  // corruption if the file doesn't exist.
+  // corruption if the file doesn't exist. It doesn't take the mutex.
   std::weak_ptr<BlobFileMeta> FindFile(uint64_t file_number) const;
 
+  // Makes the blob log being written readable, until it is sealed and
+  // added as a blob file, see `TitanCFOptions::separate_blob_on_write`.
+  void AddBlobLog(const std::shared_ptr<BlobFileMeta>& file);
+
+  // Removes the blob log after it is sealed.
+  void RemoveBlobLog(uint64_t file_number);
+
   // Must call before TitanDBImpl initialized.
   void InitializeAllFiles() {
     for (auto& file : files_) {
@@ -104,6 +148,10 @@ class BlobStorage {
   // Add a new blob file to this blob storage.
   void AddBlobFile(std::shared_ptr<BlobFileMeta>& file);
 
+  // Add new blob files to this blob storage. The file table is published
+  // once for all the files.
+  void AddBlobFiles(const std::vector<std::shared_ptr<BlobFileMeta>>& files);
+
   // Gets all obsolete blob files whose obsolete_sequence is smaller than the
   // oldest_sequence. Note that the files returned would be erased from internal
   // structure, so for the next call, the files returned before wouldn't be
@@ -145,6 +193,8 @@ class BlobStorage {
 
   void SetBlobRunMode(TitanBlobRunMode mode) { blob_run_mode_.store(mode); }
 
+  TitanBlobRunMode blob_run_mode() const { return blob_run_mode_.load(); }
+
  private:
   friend class BlobFileSet;
   friend class VersionTest;
@@ -154,7 +204,15 @@ class BlobStorage {
 
   void MarkFileObsoleteLocked(std::shared_ptr<BlobFileMeta> file,
                               SequenceNumber obsolete_sequence);
+  void AddBlobFileLocked(const std::shared_ptr<BlobFileMeta>& file);
   bool RemoveFile(uint64_t file_number);
+  // Publishes a copy of `files_` for FindFile(). Must be called whenever
+  // files are added to or removed from `files_`.
+  void PublishFilesLocked();
+  // Same as FindFile(), but also finds the blob logs being written. The
+  // blob logs are looked up first, as a sealed log is added to the files
+  // before it is removed from the logs.
+  std::shared_ptr<BlobFileMeta> FindReadableFile(uint64_t file_number) const;
 
   TitanDBOptions db_options_;
   TitanCFOptions cf_options_;
@@ -163,9 +221,16 @@ class BlobStorage {
 
   mutable port::Mutex mutex_;
 
+  using FileMap = std::unordered_map<uint64_t, std::shared_ptr<BlobFileMeta>>;
   // Only BlobStorage OWNS BlobFileMeta
   // file_number -> file_meta
-  std::unordered_map<uint64_t, std::shared_ptr<BlobFileMeta>> files_;
+  FileMap files_;
+  // Immutable copy of `files_`, read by FindFile() without the mutex. It is
+  // replaced as a whole and accessed with std::atomic_load/atomic_store.
+  std::shared_ptr<const FileMap> published_files_;
+  // The blob logs being written, replaced as a whole like
+  // `published_files_`. Updated under the mutex.
+  std::shared_ptr<const FileMap> published_blob_logs_;
   std::vector<int> levels_file_count_;
 
   class InternalComparator {
@@ -11,6 +11,7 @@
 #include "monitoring/statistics_impl.h"
 #include "port/port.h"
 #include "util/autovector.h"
+#include "util/hash.h"
 #include "util/mutexlock.h"
 #include "util/threadpool_imp.h"
 
@@ -192,6 +193,15 @@ Status TitanDBImpl::ValidateOptions(
           "Require enabling level_compaction_dynamic_level_bytes for "
           "level_merge");
     }
+    if (cf.options.separate_blob_on_write &&
+        cf.options.blob_file_compression_options.max_dict_bytes > 0) {
+      return Status::NotSupported(
+          "separate_blob_on_write doesn't support dictionary compression");
+    }
+    if (cf.options.separate_blob_on_write && options.allow_mmap_reads) {
+      return Status::NotSupported(
+          "separate_blob_on_write doesn't support allow_mmap_reads");
+    }
   }
   return Status::OK();
 }
@@ -327,10 +337,21 @@ Status TitanDBImpl::OpenImpl(const std::vector<TitanCFDescriptor>& descs,
       cf_with_compaction.push_back((*handles)[i]);
     }
   }
-  s = blob_file_set_->Open(column_families);
+  // Blob cache keys are prefixed by an id derived from the Titan directory
+  // and the identity of the base DB, so that they stay valid across reopens
+  // but don't collide between DBs sharing the same blob cache.
+  std::string db_id;
+  s = db_->GetDbIdentity(db_id);
+  if (!s.ok()) {
+    return s;
+  }
+  db_id = db_options_.dirname + db_id;
+  uint32_t blob_cache_id = Hash(db_id.data(), db_id.size(), 0);
+  s = blob_file_set_->Open(column_families, blob_cache_id);
   if (!s.ok()) {
     return s;
   }
+  AddBlobLogColumnFamilies(column_families);
   s = InitializeGC(*handles);
   TEST_SYNC_POINT_CALLBACK("TitanDBImpl::OpenImpl:BeforeInitialized", this);
   // Initialization done.
@@ -341,6 +362,7 @@ Status TitanDBImpl::OpenImpl(const std::vector<TitanCFDescriptor>& descs,
     return s;
   }
   StartBackgroundTasks();
+  StartBlobCacheWarmUp();
   // Dump options.
   TITAN_LOG_INFO(db_options_.info_log, "Titan DB open.");
   TITAN_LOG_HEADER(db_options_.info_log, "Titan git sha: %s",
@@ -356,13 +378,33 @@ Status TitanDBImpl::OpenImpl(const std::vector<TitanCFDescriptor>& descs,
 
 Status TitanDBImpl::Close() {
   Status s;
+  if (db_ && initialized_) {
+    bool seal = true;
+    TEST_SYNC_POINT_CALLBACK("TitanDBImpl::Close:SealBlobLogs", &seal);
+    Status seal_status = seal ? SealAllBlobLogs() : Status::OK();
+    if (!seal_status.ok()) {
+      TITAN_LOG_WARN(db_options_.info_log,
+                     "Titan failed to seal blob logs: %s",
+                     seal_status.ToString().c_str());
+    }
+  }
   CloseImpl();
   if (db_) {
+    Status save_status = SaveBlobCacheKeys();
+    if (!save_status.ok()) {
+      TITAN_LOG_WARN(db_options_.info_log,
+                     "Titan failed to save blob cache keys: %s",
+                     save_status.ToString().c_str());
+    }
     s = db_->Close();
     delete db_;
     db_ = nullptr;
     db_impl_ = nullptr;
   }
+  // The blob file builders are all gone with the base DB.
+  if (compression_pool_ != nullptr) {
+    compression_pool_->JoinAllThreads();
+  }
   if (lock_) {
     env_->UnlockFile(lock_);
     lock_ = nullptr;
@@ -386,6 +428,21 @@ Status TitanDBImpl::CloseImpl() {
   if (thread_pool_ != nullptr) {
     thread_pool_->JoinAllThreads();
   }
+  if (warmup_pool_ != nullptr) {
+    warmup_pool_->JoinAllThreads();
+  }
+
+  // Serves the async reads already scheduled, so that all their callbacks
+  // are called.
+  std::unique_ptr<ThreadPool> async_read_pool;
+  {
+    MutexLock l(&async_read_mutex_);
+    async_read_closed_ = true;
+    async_read_pool = std::move(async_read_pool_);
+  }
+  if (async_read_pool != nullptr) {
+    async_read_pool->WaitForJobsAndJoinAllThreads();
+  }
 
   {
     MutexLock l(&mutex_);
@@ -408,6 +465,10 @@ Status TitanDBImpl::CloseImpl() {
 Status TitanDBImpl::CreateColumnFamilies(
     const std::vector<TitanCFDescriptor>& descs,
     std::vector<ColumnFamilyHandle*>* handles) {
+  Status s = ValidateOptions(db_options_, descs);
+  if (!s.ok()) {
+    return s;
+  }
   std::vector<ColumnFamilyDescriptor> base_descs;
   std::vector<std::shared_ptr<TableFactory>> base_table_factory;
   std::vector<std::shared_ptr<TitanTableFactory>> titan_table_factory;
@@ -434,7 +495,7 @@ Status TitanDBImpl::CreateColumnFamilies(
     base_descs.emplace_back(desc.name, options);
   }
 
-  Status s = db_impl_->CreateColumnFamilies(base_descs, handles);
+  s = db_impl_->CreateColumnFamilies(base_descs, handles);
   assert(handles->size() == descs.size());
 
   if (s.ok()) {
@@ -454,6 +515,7 @@ Status TitanDBImpl::CreateColumnFamilies(
       }
       blob_file_set_->AddColumnFamilies(column_families);
     }
+    AddBlobLogColumnFamilies(column_families);
   }
   if (s.ok()) {
     for (auto& desc : descs) {
@@ -495,6 +557,7 @@ Status TitanDBImpl::DropColumnFamilies(
   }
   TEST_SYNC_POINT_CALLBACK("TitanDBImpl::DropColumnFamilies:BeforeBaseDBDropCF",
                            nullptr);
+  DropBlobLogColumnFamilies(column_families);
   Status s = db_impl_->DropColumnFamilies(handles);
   if (s.ok()) {
     MutexLock l(&mutex_);
@@ -567,28 +630,6 @@ Status TitanDBImpl::CompactFiles(
   return s;
 }
 
-Status TitanDBImpl::Put(const rocksdb::WriteOptions& options,
-                        rocksdb::ColumnFamilyHandle* column_family,
-                        const rocksdb::Slice& key,
-                        const rocksdb::Slice& value) {
-  return HasBGError() ? GetBGError()
-                      : db_->Put(options, column_family, key, value);
-}
-
-Status TitanDBImpl::Write(const rocksdb::WriteOptions& options,
-                          rocksdb::WriteBatch* updates,
-                          PostWriteCallback* callback) {
-  return HasBGError() ? GetBGError() : db_->Write(options, updates, callback);
-}
-
-Status TitanDBImpl::MultiBatchWrite(const WriteOptions& options,
-                                    std::vector<WriteBatch*>&& updates,
-                                    PostWriteCallback* callback) {
-  return HasBGError()
-             ? GetBGError()
-             : db_->MultiBatchWrite(options, std::move(updates), callback);
-}
-
 Status TitanDBImpl::Delete(const rocksdb::WriteOptions& options,
                            rocksdb::ColumnFamilyHandle* column_family,
                            const rocksdb::Slice& key) {
@@ -652,9 +693,8 @@ Status TitanDBImpl::GetImpl(const ReadOptions& options,
   BlobRecord record;
   PinnableSlice buffer;
 
-  mutex_.Lock();
-  auto storage = blob_file_set_->GetBlobStorage(handle->GetID()).lock();
-  mutex_.Unlock();
+  auto storage =
+      blob_file_set_->GetBlobStorageUnlocked(handle->GetID()).lock();
 
   if (storage) {
     StopWatch read_sw(env_->GetSystemClock().get(), statistics(stats_.get()),
@@ -677,8 +717,151 @@ Status TitanDBImpl::GetImpl(const ReadOptions& options,
                     s.ToString().c_str());
   }
   if (s.ok()) {
+    // Hands the pinned blob cache handle or the owned record buffer over to
+    // the caller, so the value is returned without copying.
+    value->Reset();
+    value->PinSlice(record.value, &buffer);
+  }
+  return s;
+}
+
+Status TitanDBImpl::GetValueRange(const ReadOptions& options,
+                                  ColumnFamilyHandle* handle, const Slice& key,
+                                  uint64_t offset, uint64_t length,
+                                  PinnableSlice* value) {
+  if (options.snapshot) {
+    return GetValueRangeImpl(options, handle, key, offset, length, value);
+  }
+  ReadOptions ro(options);
+  ManagedSnapshot snapshot(this);
+  ro.snapshot = snapshot.snapshot();
+  return GetValueRangeImpl(ro, handle, key, offset, length, value);
+}
+
+Status TitanDBImpl::GetValueRangeImpl(const ReadOptions& options,
+                                      ColumnFamilyHandle* handle,
+                                      const Slice& key, uint64_t offset,
+                                      uint64_t length, PinnableSlice* value) {
+  Status s;
+  bool is_blob_index = false;
+  PinnableSlice raw;
+  DBImpl::GetImplOptions gopts;
+  gopts.column_family = handle;
+  gopts.value = &raw;
+  gopts.is_blob_index = &is_blob_index;
+  s = db_impl_->GetImpl(options, key, gopts);
+  if (!s.ok()) return s;
+  if (!is_blob_index) {
+    // The value is stored inline.
+    value->Reset();
+    if (offset < raw.size()) {
+      value->PinSelf(Slice(raw.data() + offset,
+                           std::min<uint64_t>(length, raw.size() - offset)));
+    }
+    return s;
+  }
+
+  StopWatch get_sw(env_->GetSystemClock().get(), statistics(stats_.get()),
+                   TITAN_GET_MICROS);
+  RecordTick(statistics(stats_.get()), TITAN_NUM_GET);
+
+  BlobIndex index;
+  s = index.DecodeFrom(&raw);
+  assert(s.ok());
+  if (!s.ok()) return s;
+
+  auto storage =
+      blob_file_set_->GetBlobStorageUnlocked(handle->GetID()).lock();
+  if (!storage) {
+    TITAN_LOG_ERROR(db_options_.info_log,
+                    "Column family id:%" PRIu32 " not Found.", handle->GetID());
+    return Status::NotFound(
+        "Column family id: " + std::to_string(handle->GetID()) + " not Found.");
+  }
+  {
+    StopWatch read_sw(env_->GetSystemClock().get(), statistics(stats_.get()),
+                      TITAN_BLOB_FILE_READ_MICROS);
     value->Reset();
-    value->PinSelf(record.value);
+    s = storage->GetRange(options, index, key, offset, length, value);
+    RecordTick(statistics(stats_.get()), TITAN_BLOB_FILE_NUM_KEYS_READ);
+  }
+  if (s.IsCorruption()) {
+    TITAN_LOG_ERROR(db_options_.info_log,
+                    "Key:%s Snapshot:%" PRIu64 " GetBlobFile err:%s\n",
+                    key.ToString(true).c_str(),
+                    options.snapshot->GetSequenceNumber(),
+                    s.ToString().c_str());
+  }
+  return s;
+}
+
+Status TitanDBImpl::GetValueChunks(
+    const ReadOptions& options, ColumnFamilyHandle* handle, const Slice& key,
+    size_t chunk_size, const std::function<bool(const Slice&)>& callback) {
+  if (chunk_size == 0) {
+    return Status::InvalidArgument("chunk_size must be positive");
+  }
+  if (options.snapshot) {
+    return GetValueChunksImpl(options, handle, key, chunk_size, callback);
+  }
+  ReadOptions ro(options);
+  ManagedSnapshot snapshot(this);
+  ro.snapshot = snapshot.snapshot();
+  return GetValueChunksImpl(ro, handle, key, chunk_size, callback);
+}
+
+Status TitanDBImpl::GetValueChunksImpl(
+    const ReadOptions& options, ColumnFamilyHandle* handle, const Slice& key,
+    size_t chunk_size, const std::function<bool(const Slice&)>& callback) {
+  Status s;
+  bool is_blob_index = false;
+  PinnableSlice raw;
+  DBImpl::GetImplOptions gopts;
+  gopts.column_family = handle;
+  gopts.value = &raw;
+  gopts.is_blob_index = &is_blob_index;
+  s = db_impl_->GetImpl(options, key, gopts);
+  if (!s.ok()) return s;
+  if (!is_blob_index) {
+    // The value is stored inline.
+    for (size_t pos = 0; pos < raw.size(); pos += chunk_size) {
+      size_t n = std::min(chunk_size, raw.size() - pos);
+      if (!callback(Slice(raw.data() + pos, n))) break;
+    }
+    return s;
+  }
+
+  StopWatch get_sw(env_->GetSystemClock().get(), statistics(stats_.get()),
+                   TITAN_GET_MICROS);
+  RecordTick(statistics(stats_.get()), TITAN_NUM_GET);
+
+  BlobIndex index;
+  s = index.DecodeFrom(&raw);
+  assert(s.ok());
+  if (!s.ok()) return s;
+
+  auto storage =
+      blob_file_set_->GetBlobStorageUnlocked(handle->GetID()).lock();
+  if (!storage) {
+    TITAN_LOG_ERROR(db_options_.info_log,
+                    "Column family id:%" PRIu32 " not Found.", handle->GetID());
+    return Status::NotFound(
+        "Column family id: " + std::to_string(handle->GetID()) + " not Found.");
+  }
+  {
+    StopWatch read_sw(env_->GetSystemClock().get(), statistics(stats_.get()),
+                      TITAN_BLOB_FILE_READ_MICROS);
+    s = storage->GetChunks(options, index, key, chunk_size, callback);
+    RecordTick(statistics(stats_.get()), TITAN_BLOB_FILE_NUM_KEYS_READ);
+    RecordTick(statistics(stats_.get()), TITAN_BLOB_FILE_BYTES_READ,
+               index.blob_handle.size);
+  }
+  if (s.IsCorruption()) {
+    TITAN_LOG_ERROR(db_options_.info_log,
+                    "Key:%s Snapshot:%" PRIu64 " GetBlobFile err:%s\n",
+                    key.ToString(true).c_str(),
+                    options.snapshot->GetSequenceNumber(),
+                    s.ToString().c_str());
   }
   return s;
 }
@@ -703,17 +886,241 @@ std::vector<Status> TitanDBImpl::MultiGetImpl(
   std::vector<Status> res;
   res.resize(keys.size());
   values->resize(keys.size());
+
+  // Resolves the blob indexes of all keys first, so that the blob records
+  // can be fetched in batch per column family. The keys are looked up one
+  // by one, because the batched MultiGet of the base DB reads the blob
+  // indexes it finds as the ones of its integrated blob files.
+  // cf_id -> (positions of keys, blob indexes)
+  std::map<uint32_t, std::pair<std::vector<size_t>, std::vector<BlobIndex>>>
+      cf_blobs;
   for (size_t i = 0; i < keys.size(); i++) {
     auto value = &(*values)[i];
     PinnableSlice pinnable_value(value);
-    res[i] = GetImpl(options, handles[i], keys[i], &pinnable_value);
-    if (res[i].ok() && pinnable_value.IsPinned()) {
-      value->assign(pinnable_value.data(), pinnable_value.size());
+    bool is_blob_index = false;
+    DBImpl::GetImplOptions gopts;
+    gopts.column_family = handles[i];
+    gopts.value = &pinnable_value;
+    gopts.is_blob_index = &is_blob_index;
+    res[i] = db_impl_->GetImpl(options, keys[i], gopts);
+    if (!res[i].ok()) continue;
+    if (!is_blob_index) {
+      if (pinnable_value.IsPinned()) {
+        value->assign(pinnable_value.data(), pinnable_value.size());
+      }
+      continue;
+    }
+    BlobIndex index;
+    res[i] = index.DecodeFrom(&pinnable_value);
+    assert(res[i].ok());
+    if (!res[i].ok()) continue;
+    auto& blobs = cf_blobs[handles[i]->GetID()];
+    blobs.first.push_back(i);
+    blobs.second.push_back(index);
+  }
+  if (cf_blobs.empty()) {
+    return res;
+  }
+
+  for (auto& blobs : cf_blobs) {
+    uint32_t cf_id = blobs.first;
+    const std::vector<size_t>& positions = blobs.second.first;
+    const std::vector<BlobIndex>& indexes = blobs.second.second;
+    auto storage = blob_file_set_->GetBlobStorageUnlocked(cf_id).lock();
+    if (!storage) {
+      TITAN_LOG_ERROR(db_options_.info_log,
+                      "Column family id:%" PRIu32 " not Found.", cf_id);
+      for (auto pos : positions) {
+        res[pos] = Status::NotFound("Column family id: " +
+                                    std::to_string(cf_id) + " not Found.");
+      }
+      continue;
+    }
+
+    // Times the batch like a single Get() of a blob value.
+    StopWatch get_sw(env_->GetSystemClock().get(), statistics(stats_.get()),
+                     TITAN_GET_MICROS);
+    RecordTick(statistics(stats_.get()), TITAN_NUM_GET, indexes.size());
+    std::vector<BlobRecord> records;
+    std::vector<PinnableSlice> buffers;
+    std::vector<Status> statuses;
+    {
+      StopWatch read_sw(env_->GetSystemClock().get(), statistics(stats_.get()),
+                        TITAN_BLOB_FILE_READ_MICROS);
+      storage->MultiGet(options, indexes, &records, &buffers, &statuses);
+    }
+    for (size_t j = 0; j < positions.size(); j++) {
+      size_t pos = positions[j];
+      res[pos] = statuses[j];
+      RecordTick(statistics(stats_.get()), TITAN_BLOB_FILE_NUM_KEYS_READ);
+      RecordTick(statistics(stats_.get()), TITAN_BLOB_FILE_BYTES_READ,
+                 indexes[j].blob_handle.size);
+      if (res[pos].IsCorruption()) {
+        TITAN_LOG_ERROR(db_options_.info_log,
+                        "Key:%s Snapshot:%" PRIu64 " GetBlobFile err:%s\n",
+                        keys[pos].ToString(true).c_str(),
+                        options.snapshot->GetSequenceNumber(),
+                        res[pos].ToString().c_str());
+      }
+      if (res[pos].ok()) {
+        (*values)[pos].assign(records[j].value.data(),
+                              records[j].value.size());
+      }
     }
   }
   return res;
 }
 
+void TitanDBImpl::AsyncGet(const ReadOptions& options,
+                           ColumnFamilyHandle* handle, const Slice& key,
+                           AsyncGetCallback callback) {
+  AsyncMultiGet(options, {handle}, {key},
+                [callback](std::vector<Status>* statuses,
+                           std::vector<PinnableSlice>* values) {
+                  callback((*statuses)[0], &(*values)[0]);
+                });
+}
+
+void TitanDBImpl::AsyncMultiGet(const ReadOptions& options,
+                                const std::vector<ColumnFamilyHandle*>& handles,
+                                const std::vector<Slice>& keys,
+                                AsyncMultiGetCallback callback) {
+  assert(handles.size() == keys.size());
+  auto statuses = std::make_shared<std::vector<Status>>(keys.size());
+  auto values = std::make_shared<std::vector<PinnableSlice>>(keys.size());
+  ReadOptions ro(options);
+  ro.total_order_seek = true;
+  // The snapshot is kept until the blob values are read, so that the blob
+  // files are not purged in between.
+  std::shared_ptr<ManagedSnapshot> snapshot;
+  if (ro.snapshot == nullptr) {
+    snapshot = std::make_shared<ManagedSnapshot>(this);
+    ro.snapshot = snapshot->snapshot();
+  }
+
+  // Looks up all keys first, so that the blob values are read in batch per
+  // column family.
+  struct BlobReads {
+    std::shared_ptr<BlobStorage> storage;
+    std::vector<size_t> positions;
+    std::vector<BlobIndex> indexes;
+  };
+  // cf_id -> blob reads
+  std::map<uint32_t, BlobReads> cf_reads;
+  for (size_t i = 0; i < keys.size(); i++) {
+    auto& value = (*values)[i];
+    bool is_blob_index = false;
+    DBImpl::GetImplOptions gopts;
+    gopts.column_family = handles[i];
+    gopts.value = &value;
+    gopts.is_blob_index = &is_blob_index;
+    Status& s = (*statuses)[i];
+    s = db_impl_->GetImpl(ro, keys[i], gopts);
+    if (!s.ok() || !is_blob_index) continue;
+    BlobIndex index;
+    s = index.DecodeFrom(&value);
+    assert(s.ok());
+    if (!s.ok()) continue;
+    uint32_t cf_id = handles[i]->GetID();
+    auto& reads = cf_reads[cf_id];
+    if (!reads.storage) {
+      reads.storage = blob_file_set_->GetBlobStorageUnlocked(cf_id).lock();
+    }
+    if (!reads.storage) {
+      TITAN_LOG_ERROR(db_options_.info_log,
+                      "Column family id:%" PRIu32 " not Found.", cf_id);
+      s = Status::NotFound("Column family id: " + std::to_string(cf_id) +
+                           " not Found.");
+      continue;
+    }
+    reads.positions.push_back(i);
+    reads.indexes.push_back(index);
+  }
+  bool has_reads = false;
+  for (auto& reads : cf_reads) {
+    has_reads = has_reads || !reads.second.indexes.empty();
+  }
+  if (!has_reads) {
+    callback(statuses.get(), values.get());
+    return;
+  }
+
+  auto job = [this, ro, snapshot, cf_reads, statuses, values, callback]() {
+    for (auto& cf : cf_reads) {
+      const BlobReads& reads = cf.second;
+      if (reads.indexes.empty()) continue;
+      RecordTick(statistics(stats_.get()), TITAN_NUM_GET,
+                 reads.indexes.size());
+      std::vector<BlobRecord> records;
+      std::vector<PinnableSlice> buffers;
+      std::vector<Status> read_statuses;
+      {
+        StopWatch read_sw(env_->GetSystemClock().get(),
+                          statistics(stats_.get()),
+                          TITAN_BLOB_FILE_READ_MICROS);
+        reads.storage->MultiGet(ro, reads.indexes, &records, &buffers,
+                                &read_statuses);
+      }
+      for (size_t j = 0; j < reads.positions.size(); j++) {
+        size_t pos = reads.positions[j];
+        (*statuses)[pos] = read_statuses[j];
+        RecordTick(statistics(stats_.get()), TITAN_BLOB_FILE_NUM_KEYS_READ);
+        RecordTick(statistics(stats_.get()), TITAN_BLOB_FILE_BYTES_READ,
+                   reads.indexes[j].blob_handle.size);
+        if (read_statuses[j].IsCorruption()) {
+          TITAN_LOG_ERROR(db_options_.info_log,
+                          "Snapshot:%" PRIu64 " GetBlobFile err:%s\n",
+                          ro.snapshot->GetSequenceNumber(),
+                          read_statuses[j].ToString().c_str());
+        }
+        if (read_statuses[j].ok()) {
+          (*values)[pos].Reset();
+          (*values)[pos].PinSlice(records[j].value, &buffers[j]);
+        }
+      }
+    }
+    callback(statuses.get(), values.get());
+  };
+  if (!ScheduleAsyncRead(std::move(job))) {
+    for (auto& cf : cf_reads) {
+      for (auto pos : cf.second.positions) {
+        (*statuses)[pos] = Status::ShutdownInProgress();
+      }
+    }
+    callback(statuses.get(), values.get());
+  }
+}
+
+bool TitanDBImpl::ScheduleAsyncRead(std::function<void()>&& job) {
+  MutexLock l(&async_read_mutex_);
+  if (async_read_closed_ || shuting_down_.load(std::memory_order_acquire)) {
+    return false;
+  }
+  if (async_read_pool_ == nullptr) {
+    int32_t threads = std::max(db_options_.async_blob_read_threads, 1);
+    async_read_pool_.reset(NewThreadPool(threads));
+  }
+  async_read_pool_->SubmitJob(std::move(job));
+  return true;
+}
+
+ThreadPool* TitanDBImpl::GetBlobCompressionPool(
+    const TitanCFOptions& cf_options) {
+  uint32_t threads = cf_options.blob_file_compression_options.parallel_threads;
+  if (threads <= 1 || cf_options.blob_file_compression == kNoCompression) {
+    return nullptr;
+  }
+  MutexLock l(&compression_pool_mutex_);
+  if (compression_pool_ == nullptr) {
+    compression_pool_.reset(NewThreadPool(0));
+  }
+  // Shared by the column families, so sized to the largest one.
+  if (compression_pool_->GetBackgroundThreads() < static_cast<int>(threads)) {
+    compression_pool_->SetBackgroundThreads(static_cast<int>(threads));
+  }
+  return compression_pool_.get();
+}
+
 Iterator* TitanDBImpl::NewIterator(const TitanReadOptions& options,
                                    ColumnFamilyHandle* handle) {
   TitanReadOptions options_copy = options;
@@ -733,9 +1140,8 @@ Iterator* TitanDBImpl::NewIteratorImpl(
     std::shared_ptr<ManagedSnapshot> snapshot) {
   auto cfd = reinterpret_cast<ColumnFamilyHandleImpl*>(handle)->cfd();
 
-  mutex_.Lock();
-  auto storage = blob_file_set_->GetBlobStorage(handle->GetID()).lock();
-  mutex_.Unlock();
+  auto storage =
+      blob_file_set_->GetBlobStorageUnlocked(handle->GetID()).lock();
 
   if (!storage) {
     TITAN_LOG_ERROR(db_options_.info_log,
@@ -747,9 +1153,18 @@ Iterator* TitanDBImpl::NewIteratorImpl(
       options, cfd, options.snapshot->GetSequenceNumber(),
       nullptr /*read_callback*/, true /*expose_blob_index*/,
       true /*allow_refresh*/));
-  return new TitanDBIterator(options, storage.get(), snapshot, std::move(iter),
-                             env_->GetSystemClock().get(), stats_.get(),
-                             db_options_.info_log.get());
+  auto titan_iter = new TitanDBIterator(
+      options, storage.get(), snapshot, std::move(iter),
+      env_->GetSystemClock().get(), stats_.get(), db_options_.info_log.get());
+  if (options.iterate_upper_bound != nullptr &&
+      options.bounded_scan_prefetch_size > 0 && !options.key_only) {
+    // Plans the bounded scan with the blob files overlapping the bounds.
+    std::vector<uint64_t> files;
+    storage->GetBlobFilesOverlapping(options.iterate_lower_bound,
+                                     *options.iterate_upper_bound, &files);
+    titan_iter->SetScanFiles(files);
+  }
+  return titan_iter;
 }
 
 Status TitanDBImpl::NewIterators(
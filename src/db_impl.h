@@ -7,6 +7,7 @@
 
 #include "blob_file_manager.h"
 #include "blob_file_set.h"
+#include "blob_log_writer.h"
 #include "table_factory.h"
 #include "titan/db.h"
 #include "titan_stats.h"
@@ -57,6 +58,14 @@ class TitanDBImpl : public TitanDB {
 
   Status CloseImpl();
 
+  // Saves the locations of the records of this DB in the blob caches, see
+  // `TitanDBOptions::blob_cache_warmup`.
+  Status SaveBlobCacheKeys();
+
+  // Column family id -> file number -> offsets of the blob cache keys.
+  using BlobCacheKeys =
+      std::map<uint32_t, std::map<uint64_t, std::vector<uint64_t>>>;
+
   using TitanDB::Put;
   Status Put(const WriteOptions& options, ColumnFamilyHandle* column_family,
              const Slice& key, const Slice& value) override;
@@ -98,6 +107,26 @@ class TitanDBImpl : public TitanDB {
                                const std::vector<Slice>& keys,
                                std::vector<std::string>* values) override;
 
+  using TitanDB::GetValueRange;
+  Status GetValueRange(const ReadOptions& options, ColumnFamilyHandle* handle,
+                       const Slice& key, uint64_t offset, uint64_t length,
+                       PinnableSlice* value) override;
+
+  using TitanDB::GetValueChunks;
+  Status GetValueChunks(
+      const ReadOptions& options, ColumnFamilyHandle* handle,
+      const Slice& key, size_t chunk_size,
+      const std::function<bool(const Slice&)>& callback) override;
+
+  using TitanDB::AsyncGet;
+  void AsyncGet(const ReadOptions& options, ColumnFamilyHandle* handle,
+                const Slice& key, AsyncGetCallback callback) override;
+
+  void AsyncMultiGet(const ReadOptions& options,
+                     const std::vector<ColumnFamilyHandle*>& handles,
+                     const std::vector<Slice>& keys,
+                     AsyncMultiGetCallback callback) override;
+
   using TitanDB::NewIterator;
   Iterator* NewIterator(const TitanReadOptions& options,
                         ColumnFamilyHandle* handle) override;
@@ -154,6 +183,8 @@ class TitanDBImpl : public TitanDB {
 
   bool initialized() const { return initialized_; }
 
+  void OnFlushBegin(const FlushJobInfo& flush_job_info);
+
   void OnFlushCompleted(const FlushJobInfo& flush_job_info);
 
   void OnCompactionCompleted(const CompactionJobInfo& compaction_job_info);
@@ -198,6 +229,23 @@ class TitanDBImpl : public TitanDB {
   Status GetImpl(const ReadOptions& options, ColumnFamilyHandle* handle,
                  const Slice& key, PinnableSlice* value);
 
+  Status GetValueRangeImpl(const ReadOptions& options,
+                           ColumnFamilyHandle* handle, const Slice& key,
+                           uint64_t offset, uint64_t length,
+                           PinnableSlice* value);
+
+  Status GetValueChunksImpl(
+      const ReadOptions& options, ColumnFamilyHandle* handle,
+      const Slice& key, size_t chunk_size,
+      const std::function<bool(const Slice&)>& callback);
+
+  // Runs "job" on the async read pool. Returns false if the DB is closing.
+  bool ScheduleAsyncRead(std::function<void()>&& job);
+
+  // Returns the pool shared by the blob file builders of the column family
+  // to compress in parallel, or nullptr if it doesn't compress in parallel.
+  ThreadPool* GetBlobCompressionPool(const TitanCFOptions& cf_options);
+
   std::vector<Status> MultiGetImpl(
       const ReadOptions& options,
       const std::vector<ColumnFamilyHandle*>& handles,
@@ -209,6 +257,89 @@ class TitanDBImpl : public TitanDB {
 
   Status InitializeGC(const std::vector<ColumnFamilyHandle*>& cf_handles);
 
+  // A blob log of a column family with `separate_blob_on_write`.
+  struct BlobLog {
+    uint32_t cf_id;
+    std::shared_ptr<BlobStorage> storage;
+    // The lock of the column family, which guards the fields below.
+    std::shared_ptr<port::Mutex> mutex;
+    // Signaled when the log is sealed.
+    std::shared_ptr<port::CondVar> cv;
+    // Reset once the log is sealed.
+    std::unique_ptr<BlobLogWriter> writer;
+    // The writes whose values are appended, but whose blob indexes are not
+    // written to the base DB yet.
+    int pending_writes{0};
+    // Set when the log reaches `blob_file_target_size` or the column
+    // family is flushed. A full log is sealed after its last pending
+    // write, so that GC never sees the file before all its blob indexes
+    // are in the base DB.
+    bool full{false};
+    // Set while the log is sealed without the lock.
+    bool sealing{false};
+  };
+
+  struct BlobLogInfo {
+    TitanCFOptions cf_options;
+    std::shared_ptr<BlobStorage> storage;
+    // Guards the fields below and the logs of the column family.
+    std::shared_ptr<port::Mutex> mutex;
+    std::shared_ptr<port::CondVar> cv;
+    // The log values are appended to, created on the first separated value.
+    std::shared_ptr<BlobLog> active;
+    // The logs not sealed yet, including the active one. The logs sealed
+    // by their last pending write are pruned when a log is created.
+    std::vector<std::shared_ptr<BlobLog>> unsealed;
+    // Set when the column family is dropped, after which no value is
+    // separated.
+    bool dropped{false};
+  };
+
+  using BlobLogMap =
+      std::unordered_map<uint32_t, std::shared_ptr<BlobLogInfo>>;
+
+  // Sets up the blob logs of the column families with
+  // `separate_blob_on_write`.
+  void AddBlobLogColumnFamilies(
+      const std::map<uint32_t, TitanCFOptions>& column_families);
+
+  // Stops separating values of the dropped column families, and seals
+  // their blob logs without pending writes.
+  void DropBlobLogColumnFamilies(const std::vector<uint32_t>& column_families);
+
+  // Appends the values of "updates" at least `min_blob_size` in the column
+  // families with `separate_blob_on_write` to their blob logs, and sets
+  // "*rewritten" to a copy of the batch with the blob indexes instead.
+  // "*rewritten" is left null if no value is separated. The logs appended
+  // to are added to "*logs", and FinishBlobLogWrites() must be called with
+  // them once the batch is written to the base DB, even if it fails.
+  Status SeparateBlobs(const WriteOptions& options, WriteBatch* updates,
+                       std::unique_ptr<WriteBatch>* rewritten,
+                       std::vector<std::shared_ptr<BlobLog>>* logs);
+
+  void FinishBlobLogWrites(const std::vector<std::shared_ptr<BlobLog>>& logs);
+
+  // Creates the active blob log of the column family.
+  // REQUIRES: info->mutex held
+  Status NewBlobLogLocked(uint32_t cf_id, BlobLogInfo* info);
+
+  // Syncs the records of the blob log flushed by a pending write.
+  Status SyncBlobLog(const std::shared_ptr<BlobLog>& log);
+
+  // Seals the full blob log without pending writes as a blob file of its
+  // column family, unless it is sealed already. Waits if another thread
+  // is sealing it.
+  // REQUIRES: log->mutex not held
+  Status SealBlobLog(const std::shared_ptr<BlobLog>& log);
+
+  // Marks all the blob logs of the column family full, and seals those
+  // without pending writes. The others are synced if "sync_pending", and
+  // sealed after their last pending write.
+  Status SealBlobLogs(BlobLogInfo* info, bool sync_pending);
+
+  // Seals the blob logs of all the column families.
+  Status SealAllBlobLogs();
+
   Status ExtractGCStatsFromTableProperty(
       const std::shared_ptr<const TableProperties>& table_properties,
       bool to_add, std::map<uint64_t, int64_t>* blob_file_size_diff);
@@ -275,6 +406,13 @@ class TitanDBImpl : public TitanDB {
 
   void DumpStats();
 
+  // Loads the blob cache keys saved by the last Close(), and starts to
+  // read their records into the blob caches in the background.
+  void StartBlobCacheWarmUp();
+
+  // Reads the records of "keys" into the blob caches.
+  void WarmUpBlobCache(const BlobCacheKeys& keys);
+
   FileLock* lock_{nullptr};
   // The lock sequence must be Titan.mutex_.Lock() -> Base DB mutex_.Lock()
   // while the unlock sequence must be Base DB mutex.Unlock() ->
@@ -304,6 +442,20 @@ class TitanDBImpl : public TitanDB {
   // Thread pool for running background GC.
   std::unique_ptr<ThreadPool> thread_pool_;
 
+  // Thread pool for the blob reads of async reads, created on the first
+  // async read. Access while holding async_read_mutex_.
+  port::Mutex async_read_mutex_;
+  std::unique_ptr<ThreadPool> async_read_pool_;
+  bool async_read_closed_{false};
+
+  // Thread pool for warming up the blob caches after open.
+  std::unique_ptr<ThreadPool> warmup_pool_;
+
+  // Thread pool for the parallel compression of blob files, created on the
+  // first use. Access while holding compression_pool_mutex_.
+  port::Mutex compression_pool_mutex_;
+  std::unique_ptr<ThreadPool> compression_pool_;
+
   // TitanStats is turned on only if statistics field of DBOptions
   // is not null.
   std::unique_ptr<TitanStats> stats_;
@@ -342,6 +494,18 @@ class TitanDBImpl : public TitanDB {
   int disable_titandb_file_deletions_ = 0;
 
   std::atomic_bool shuting_down_{false};
+
+  // Guards the updates of published_blob_logs_, which is read without
+  // locks on the write path. The blob logs of a column family are guarded
+  // by the mutex of its BlobLogInfo, which is never locked while holding
+  // mutex_, and not held across the writes to the base DB, since a write
+  // stall waits for the flush which seals the blob logs.
+  port::Mutex blob_log_mutex_;
+  std::shared_ptr<const BlobLogMap> published_blob_logs_{
+      std::make_shared<BlobLogMap>()};
+  // Whether any column family has `separate_blob_on_write`, checked before
+  // loading published_blob_logs_ on the write path.
+  std::atomic<bool> has_blob_logs_{false};
 };
 
 }  // namespace titandb
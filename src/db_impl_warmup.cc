@@ -0,0 +1,218 @@
+#ifndef __STDC_FORMAT_MACROS
+#define __STDC_FORMAT_MACROS
+#endif
+
+#include <algorithm>
+#include <cinttypes>
+
+#include "rocksdb/rate_limiter.h"
+#include "test_util/sync_point.h"
+#include "util/coding.h"
+#include "util/crc32c.h"
+
+#include "blob_file_reader.h"
+#include "db_impl.h"
+#include "titan_logging.h"
+
+namespace rocksdb {
+namespace titandb {
+
+namespace {
+
+// The blob cache keys saved by Close() are a list of
+//
+//    column family id, file number, number of offsets, offsets...
+//
+// in varints, where the offsets of a file are ascending and delta encoded,
+// followed by the masked crc32c of the list in fixed32.
+std::string BlobCacheKeysFileName(const std::string& dirname) {
+  return dirname + "/BLOB_CACHE_KEYS";
+}
+
+void EncodeBlobCacheKeys(const TitanDBImpl::BlobCacheKeys& keys,
+                         std::string* dst) {
+  for (auto& cf : keys) {
+    for (auto& file : cf.second) {
+      PutVarint32(dst, cf.first);
+      PutVarint64(dst, file.first);
+      PutVarint64(dst, file.second.size());
+      uint64_t last_offset = 0;
+      for (uint64_t offset : file.second) {
+        PutVarint64(dst, offset - last_offset);
+        last_offset = offset;
+      }
+    }
+  }
+  PutFixed32(dst, crc32c::Mask(crc32c::Value(dst->data(), dst->size())));
+}
+
+Status DecodeBlobCacheKeys(Slice src, TitanDBImpl::BlobCacheKeys* keys) {
+  if (src.size() < sizeof(uint32_t)) {
+    return Status::Corruption("BlobCacheKeys", "too short");
+  }
+  size_t size = src.size() - sizeof(uint32_t);
+  uint32_t crc = crc32c::Unmask(DecodeFixed32(src.data() + size));
+  if (crc != crc32c::Value(src.data(), size)) {
+    return Status::Corruption("BlobCacheKeys", "checksum mismatch");
+  }
+  src = Slice(src.data(), size);
+  while (!src.empty()) {
+    uint32_t cf_id;
+    uint64_t file_number, num_offsets;
+    if (!GetVarint32(&src, &cf_id) || !GetVarint64(&src, &file_number) ||
+        !GetVarint64(&src, &num_offsets)) {
+      return Status::Corruption("BlobCacheKeys", "bad file entry");
+    }
+    auto& offsets = (*keys)[cf_id][file_number];
+    uint64_t offset = 0;
+    for (uint64_t i = 0; i < num_offsets; i++) {
+      uint64_t delta;
+      if (!GetVarint64(&src, &delta)) {
+        return Status::Corruption("BlobCacheKeys", "bad offset");
+      }
+      offset += delta;
+      offsets.push_back(offset);
+    }
+  }
+  return Status::OK();
+}
+
+}  // namespace
+
+Status TitanDBImpl::SaveBlobCacheKeys() {
+  if (!db_options_.blob_cache_warmup || !initialized_) {
+    return Status::OK();
+  }
+  std::vector<std::shared_ptr<Cache>> caches;
+  std::vector<std::pair<uint32_t, std::shared_ptr<BlobStorage>>> storages;
+  uint32_t blob_cache_id;
+  {
+    MutexLock l(&mutex_);
+    blob_cache_id = blob_file_set_->blob_cache_id();
+    for (auto& cf : cf_info_) {
+      auto& cache = cf.second.immutable_cf_options.blob_cache;
+      if (cache == nullptr) {
+        continue;
+      }
+      if (std::find(caches.begin(), caches.end(), cache) == caches.end()) {
+        caches.push_back(cache);
+      }
+      auto storage = blob_file_set_->GetBlobStorage(cf.first).lock();
+      if (storage != nullptr) {
+        storages.emplace_back(cf.first, std::move(storage));
+      }
+    }
+  }
+
+  // file number -> offsets of the records of this DB in the caches.
+  std::map<uint64_t, std::vector<uint64_t>> cached;
+  for (auto& cache : caches) {
+    cache->ApplyToAllEntries(
+        [&](const Slice& key, void* /*value*/, size_t /*charge*/,
+            Cache::DeleterFn /*deleter*/) {
+          uint32_t cache_id;
+          uint64_t file_number, offset;
+          if (BlobCacheKey::DecodeFrom(key, &cache_id, &file_number,
+                                       &offset) &&
+              cache_id == blob_cache_id) {
+            cached[file_number].push_back(offset);
+          }
+        },
+        Cache::ApplyToAllEntriesOptions());
+  }
+
+  BlobCacheKeys keys;
+  uint64_t num_keys = 0;
+  for (auto& file : cached) {
+    for (auto& storage : storages) {
+      if (storage.second->FindFile(file.first).lock() != nullptr) {
+        auto& offsets = keys[storage.first][file.first];
+        offsets = std::move(file.second);
+        std::sort(offsets.begin(), offsets.end());
+        offsets.erase(std::unique(offsets.begin(), offsets.end()),
+                      offsets.end());
+        num_keys += offsets.size();
+        break;
+      }
+    }
+  }
+  std::string data;
+  EncodeBlobCacheKeys(keys, &data);
+  Status s = WriteStringToFile(env_, data, BlobCacheKeysFileName(dirname_),
+                               true /*should_sync*/);
+  if (s.ok()) {
+    TITAN_LOG_INFO(db_options_.info_log,
+                   "Titan saved %" PRIu64 " blob cache keys.", num_keys);
+  }
+  return s;
+}
+
+void TitanDBImpl::StartBlobCacheWarmUp() {
+  std::string file_name = BlobCacheKeysFileName(dirname_);
+  if (!env_->FileExists(file_name).ok()) {
+    return;
+  }
+  std::string data;
+  Status s = ReadFileToString(env_, file_name, &data);
+  // The keys are loaded only once, so that a crash afterwards doesn't warm
+  // up the stale ones again.
+  env_->DeleteFile(file_name);
+  if (!s.ok() || !db_options_.blob_cache_warmup) {
+    return;
+  }
+  auto keys = std::make_shared<BlobCacheKeys>();
+  s = DecodeBlobCacheKeys(data, keys.get());
+  if (!s.ok()) {
+    TITAN_LOG_WARN(db_options_.info_log,
+                   "Titan failed to load blob cache keys: %s",
+                   s.ToString().c_str());
+    return;
+  }
+  warmup_pool_.reset(NewThreadPool(1));
+  warmup_pool_->SubmitJob([this, keys]() { WarmUpBlobCache(*keys); });
+}
+
+void TitanDBImpl::WarmUpBlobCache(const BlobCacheKeys& keys) {
+  std::unique_ptr<RateLimiter> rate_limiter;
+  if (db_options_.blob_cache_warmup_bytes_per_sec > 0) {
+    rate_limiter.reset(NewGenericRateLimiter(
+        static_cast<int64_t>(db_options_.blob_cache_warmup_bytes_per_sec),
+        100 * 1000 /*refill_period_us*/, 10 /*fairness*/,
+        RateLimiter::Mode::kReadsOnly));
+  }
+  uint64_t num_loaded = 0;
+  uint64_t num_failed = 0;
+  for (auto& cf : keys) {
+    std::shared_ptr<BlobStorage> storage;
+    {
+      MutexLock l(&mutex_);
+      storage = blob_file_set_->GetBlobStorage(cf.first).lock();
+    }
+    if (storage == nullptr) {
+      continue;
+    }
+    for (auto& file : cf.second) {
+      for (uint64_t offset : file.second) {
+        if (shuting_down_.load(std::memory_order_acquire)) {
+          return;
+        }
+        // The file may have been deleted by GC since the keys were saved.
+        Status s =
+            storage->LoadIntoCache(file.first, offset, rate_limiter.get());
+        if (s.ok()) {
+          num_loaded++;
+        } else {
+          num_failed++;
+        }
+      }
+    }
+  }
+  TITAN_LOG_INFO(db_options_.info_log,
+                 "Titan blob cache warm-up loaded %" PRIu64
+                 " records, %" PRIu64 " failed.",
+                 num_loaded, num_failed);
+  TEST_SYNC_POINT("TitanDBImpl::WarmUpBlobCache:Finish");
+}
+
+}  // namespace titandb
+}  // namespace rocksdb
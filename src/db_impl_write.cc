@@ -0,0 +1,530 @@
+#ifndef __STDC_FORMAT_MACROS
+#define __STDC_FORMAT_MACROS
+#endif
+
+#include <algorithm>
+#include <cinttypes>
+#include <functional>
+
+#include "db/write_batch_internal.h"
+#include "test_util/sync_point.h"
+
+#include "db_impl.h"
+#include "titan_logging.h"
+
+namespace rocksdb {
+namespace titandb {
+
+namespace {
+
+// Copies a write batch, with the values separated by "separate" replaced
+// by their blob indexes. "separate" leaves the index empty if the value
+// stays in the batch. Transactional batches are not supported.
+class BlobSeparator : public WriteBatch::Handler {
+ public:
+  using SeparateFunc = std::function<Status(
+      uint32_t cf_id, const Slice& key, const Slice& value, std::string*)>;
+
+  BlobSeparator(WriteBatch* batch, SeparateFunc&& separate)
+      : batch_(batch), separate_(std::move(separate)) {}
+
+  Status PutCF(uint32_t cf_id, const Slice& key, const Slice& value) override {
+    std::string index;
+    Status s = separate_(cf_id, key, value, &index);
+    if (!s.ok()) return s;
+    if (index.empty()) {
+      return WriteBatchInternal::Put(batch_, cf_id, key, value);
+    }
+    return WriteBatchInternal::PutBlobIndex(batch_, cf_id, key, index);
+  }
+
+  Status DeleteCF(uint32_t cf_id, const Slice& key) override {
+    return WriteBatchInternal::Delete(batch_, cf_id, key);
+  }
+
+  Status SingleDeleteCF(uint32_t cf_id, const Slice& key) override {
+    return WriteBatchInternal::SingleDelete(batch_, cf_id, key);
+  }
+
+  Status DeleteRangeCF(uint32_t cf_id, const Slice& begin_key,
+                       const Slice& end_key) override {
+    return WriteBatchInternal::DeleteRange(batch_, cf_id, begin_key, end_key);
+  }
+
+  Status MergeCF(uint32_t cf_id, const Slice& key,
+                 const Slice& value) override {
+    return WriteBatchInternal::Merge(batch_, cf_id, key, value);
+  }
+
+  Status PutBlobIndexCF(uint32_t cf_id, const Slice& key,
+                        const Slice& value) override {
+    return WriteBatchInternal::PutBlobIndex(batch_, cf_id, key, value);
+  }
+
+  void LogData(const Slice& blob) override { batch_->PutLogData(blob); }
+
+ private:
+  WriteBatch* batch_;
+  SeparateFunc separate_;
+};
+
+// Finds whether a write batch has any value to separate, stopping at the
+// first one.
+class BlobFinder : public WriteBatch::Handler {
+ public:
+  using MatchFunc = std::function<bool(uint32_t cf_id, const Slice& value)>;
+
+  explicit BlobFinder(MatchFunc&& match) : match_(std::move(match)) {}
+
+  bool found() const { return found_; }
+
+  bool Continue() override { return !found_; }
+
+  Status PutCF(uint32_t cf_id, const Slice& /*key*/,
+               const Slice& value) override {
+    found_ = match_(cf_id, value);
+    return Status::OK();
+  }
+
+  Status DeleteCF(uint32_t /*cf_id*/, const Slice& /*key*/) override {
+    return Status::OK();
+  }
+
+  Status SingleDeleteCF(uint32_t /*cf_id*/, const Slice& /*key*/) override {
+    return Status::OK();
+  }
+
+  Status DeleteRangeCF(uint32_t /*cf_id*/, const Slice& /*begin_key*/,
+                       const Slice& /*end_key*/) override {
+    return Status::OK();
+  }
+
+  Status MergeCF(uint32_t /*cf_id*/, const Slice& /*key*/,
+                 const Slice& /*value*/) override {
+    return Status::OK();
+  }
+
+  Status PutBlobIndexCF(uint32_t /*cf_id*/, const Slice& /*key*/,
+                        const Slice& /*value*/) override {
+    return Status::OK();
+  }
+
+  void LogData(const Slice& /*blob*/) override {}
+
+ private:
+  MatchFunc match_;
+  bool found_{false};
+};
+
+}  // namespace
+
+Status TitanDBImpl::Put(const rocksdb::WriteOptions& options,
+                        rocksdb::ColumnFamilyHandle* column_family,
+                        const rocksdb::Slice& key,
+                        const rocksdb::Slice& value) {
+  if (HasBGError()) return GetBGError();
+  if (has_blob_logs_.load(std::memory_order_acquire)) {
+    WriteBatch batch;
+    Status s = batch.Put(column_family, key, value);
+    if (!s.ok()) return s;
+    return Write(options, &batch, nullptr /*callback*/);
+  }
+  return db_->Put(options, column_family, key, value);
+}
+
+Status TitanDBImpl::Write(const rocksdb::WriteOptions& options,
+                          rocksdb::WriteBatch* updates,
+                          PostWriteCallback* callback) {
+  if (HasBGError()) return GetBGError();
+  std::unique_ptr<WriteBatch> rewritten;
+  std::vector<std::shared_ptr<BlobLog>> logs;
+  Status s = SeparateBlobs(options, updates, &rewritten, &logs);
+  if (s.ok()) {
+    s = db_->Write(options, rewritten ? rewritten.get() : updates, callback);
+  }
+  FinishBlobLogWrites(logs);
+  return s;
+}
+
+Status TitanDBImpl::MultiBatchWrite(const WriteOptions& options,
+                                    std::vector<WriteBatch*>&& updates,
+                                    PostWriteCallback* callback) {
+  if (HasBGError()) return GetBGError();
+  std::vector<std::unique_ptr<WriteBatch>> rewritten(updates.size());
+  std::vector<std::shared_ptr<BlobLog>> logs;
+  Status s;
+  for (size_t i = 0; i < updates.size() && s.ok(); i++) {
+    s = SeparateBlobs(options, updates[i], &rewritten[i], &logs);
+    if (s.ok() && rewritten[i]) {
+      updates[i] = rewritten[i].get();
+    }
+  }
+  if (s.ok()) {
+    s = db_->MultiBatchWrite(options, std::move(updates), callback);
+  }
+  FinishBlobLogWrites(logs);
+  return s;
+}
+
+void TitanDBImpl::AddBlobLogColumnFamilies(
+    const std::map<uint32_t, TitanCFOptions>& column_families) {
+  std::map<uint32_t, std::shared_ptr<BlobStorage>> storages;
+  {
+    MutexLock l(&mutex_);
+    for (auto& cf : column_families) {
+      if (cf.second.separate_blob_on_write) {
+        storages[cf.first] = blob_file_set_->GetBlobStorage(cf.first).lock();
+      }
+    }
+  }
+  if (storages.empty()) {
+    return;
+  }
+  MutexLock l(&blob_log_mutex_);
+  auto blob_logs = std::make_shared<BlobLogMap>(*published_blob_logs_);
+  for (auto& storage : storages) {
+    assert(storage.second != nullptr);
+    auto info = std::make_shared<BlobLogInfo>();
+    info->cf_options = column_families.at(storage.first);
+    info->storage = storage.second;
+    info->mutex = std::make_shared<port::Mutex>();
+    info->cv = std::make_shared<port::CondVar>(info->mutex.get());
+    (*blob_logs)[storage.first] = info;
+  }
+  std::atomic_store(&published_blob_logs_,
+                    std::shared_ptr<const BlobLogMap>(blob_logs));
+  has_blob_logs_.store(true, std::memory_order_release);
+}
+
+void TitanDBImpl::DropBlobLogColumnFamilies(
+    const std::vector<uint32_t>& column_families) {
+  std::vector<std::shared_ptr<BlobLogInfo>> dropped;
+  {
+    MutexLock l(&blob_log_mutex_);
+    auto blob_logs = std::make_shared<BlobLogMap>(*published_blob_logs_);
+    for (uint32_t cf_id : column_families) {
+      auto it = blob_logs->find(cf_id);
+      if (it != blob_logs->end()) {
+        dropped.push_back(it->second);
+        blob_logs->erase(it);
+      }
+    }
+    if (dropped.empty()) {
+      return;
+    }
+    std::atomic_store(&published_blob_logs_,
+                      std::shared_ptr<const BlobLogMap>(blob_logs));
+  }
+  for (auto& info : dropped) {
+    {
+      // The writes which loaded the map before the drop see the flag.
+      MutexLock l(info->mutex.get());
+      info->dropped = true;
+    }
+    SealBlobLogs(info.get(), false /*sync_pending*/);
+  }
+}
+
+Status TitanDBImpl::SeparateBlobs(const WriteOptions& options,
+                                  WriteBatch* updates,
+                                  std::unique_ptr<WriteBatch>* rewritten,
+                                  std::vector<std::shared_ptr<BlobLog>>* logs) {
+  if (!has_blob_logs_.load(std::memory_order_acquire)) {
+    return Status::OK();
+  }
+  std::shared_ptr<const BlobLogMap> blob_logs =
+      std::atomic_load(&published_blob_logs_);
+  auto find_info = [&](uint32_t cf_id, const Slice& value) -> BlobLogInfo* {
+    auto it = blob_logs->find(cf_id);
+    if (it == blob_logs->end()) {
+      return nullptr;
+    }
+    BlobLogInfo* info = it->second.get();
+    if (value.size() < info->cf_options.min_blob_size ||
+        info->storage->blob_run_mode() != TitanBlobRunMode::kNormal) {
+      return nullptr;
+    }
+    return info;
+  };
+  // The batches without values to separate are written as they are.
+  BlobFinder finder([&](uint32_t cf_id, const Slice& value) {
+    return find_info(cf_id, value) != nullptr;
+  });
+  Status s = updates->Iterate(&finder);
+  if (!s.ok() || !finder.found()) {
+    return s;
+  }
+
+  std::unique_ptr<WriteBatch> batch(new WriteBatch());
+  // The logs appended to by this batch.
+  std::vector<std::shared_ptr<BlobLog>> appended;
+  BlobSeparator separator(
+      batch.get(), [&](uint32_t cf_id, const Slice& key, const Slice& value,
+                       std::string* index) -> Status {
+        BlobLogInfo* info = find_info(cf_id, value);
+        if (info == nullptr) {
+          return Status::OK();
+        }
+        MutexLock l(info->mutex.get());
+        if (info->dropped) {
+          return Status::OK();
+        }
+        if (info->active == nullptr) {
+          Status s = NewBlobLogLocked(cf_id, info);
+          if (!s.ok()) return s;
+        }
+        std::shared_ptr<BlobLog> log = info->active;
+        BlobRecord record;
+        record.key = key;
+        record.value = value;
+        BlobIndex blob_index;
+        blob_index.file_number = log->writer->file_number();
+        log->writer->Add(record, &blob_index.blob_handle);
+        if (!log->writer->status().ok()) {
+          return log->writer->status();
+        }
+        blob_index.EncodeTo(index);
+        if (std::find(appended.begin(), appended.end(), log) ==
+            appended.end()) {
+          // Keeps the log unsealed until the batch is written.
+          log->pending_writes++;
+          appended.push_back(log);
+        }
+        if (log->writer->file_size() >=
+            info->cf_options.blob_file_target_size) {
+          log->full = true;
+          info->active.reset();
+        }
+        return Status::OK();
+      });
+  s = updates->Iterate(&separator);
+  for (auto& log : appended) {
+    // The records are flushed so that they can be read once the batch is
+    // written.
+    Status flush_s;
+    {
+      MutexLock l(log->mutex.get());
+      flush_s = log->writer->Flush(false /*sync*/);
+    }
+    if (s.ok()) {
+      s = flush_s;
+    }
+    logs->push_back(log);
+  }
+  // The records are synced before the WAL if the write is synced, without
+  // blocking the appends to the logs.
+  for (size_t i = 0; s.ok() && options.sync && i < appended.size(); i++) {
+    s = SyncBlobLog(appended[i]);
+  }
+  if (s.ok()) {
+    *rewritten = std::move(batch);
+  }
+  return s;
+}
+
+void TitanDBImpl::FinishBlobLogWrites(
+    const std::vector<std::shared_ptr<BlobLog>>& logs) {
+  for (auto& log : logs) {
+    bool seal = false;
+    {
+      MutexLock l(log->mutex.get());
+      assert(log->pending_writes > 0);
+      log->pending_writes--;
+      seal = log->full && log->pending_writes == 0;
+    }
+    if (!seal) {
+      continue;
+    }
+    // The log is sealed off the write path if possible. Until then it stays
+    // readable, and a flush or close seals it if the job hasn't yet.
+    if (thread_pool_ != nullptr &&
+        !shuting_down_.load(std::memory_order_acquire)) {
+      thread_pool_->SubmitJob([this, log]() { SealBlobLog(log); });
+    } else {
+      SealBlobLog(log);
+    }
+  }
+}
+
+Status TitanDBImpl::NewBlobLogLocked(uint32_t cf_id, BlobLogInfo* info) {
+  info->mutex->AssertHeld();
+  auto& unsealed = info->unsealed;
+  unsealed.erase(std::remove_if(unsealed.begin(), unsealed.end(),
+                                [](const std::shared_ptr<BlobLog>& log) {
+                                  return log->writer == nullptr;
+                                }),
+                 unsealed.end());
+  std::unique_ptr<BlobFileHandle> handle;
+  Status s = blob_manager_->NewFile(&handle);
+  if (!s.ok()) return s;
+  std::shared_ptr<BlobLog> log = std::make_shared<BlobLog>();
+  log->cf_id = cf_id;
+  log->storage = info->storage;
+  log->mutex = info->mutex;
+  log->cv = info->cv;
+  log->writer.reset(
+      new BlobLogWriter(info->cf_options, cf_id, std::move(handle)));
+  s = log->writer->status();
+  if (!s.ok()) {
+    blob_manager_->DeleteFile(log->writer->ReleaseHandle());
+    return s;
+  }
+  // The size of the meta is not used to read a blob log.
+  log->storage->AddBlobLog(std::make_shared<BlobFileMeta>(
+      log->writer->file_number(), 0 /*file_size*/, 0 /*file_entries*/,
+      0 /*file_level*/, "" /*smallest_key*/, "" /*largest_key*/));
+  info->active = log;
+  unsealed.push_back(log);
+  return Status::OK();
+}
+
+Status TitanDBImpl::SyncBlobLog(const std::shared_ptr<BlobLog>& log) {
+  // The writer is not reset while the write is pending.
+  assert(log->pending_writes > 0);
+  Status s = log->writer->Sync();
+  if (s.IsNotSupported()) {
+    MutexLock l(log->mutex.get());
+    s = log->writer->Flush(true /*sync*/);
+  }
+  if (!s.ok()) {
+    // The records of the other writes to the log may be lost as well.
+    TITAN_LOG_ERROR(db_options_.info_log,
+                    "Titan failed to sync blob log %" PRIu64 ": %s",
+                    log->writer->file_number(), s.ToString().c_str());
+    MutexLock l(&mutex_);
+    SetBGError(s);
+  }
+  return s;
+}
+
+Status TitanDBImpl::SealBlobLog(const std::shared_ptr<BlobLog>& log) {
+  {
+    MutexLock l(log->mutex.get());
+    while (log->sealing) {
+      log->cv->Wait();
+    }
+    if (log->writer == nullptr) {
+      return Status::OK();
+    }
+    assert(log->full && log->pending_writes == 0);
+    log->sealing = true;
+  }
+  // The writer of a full log without pending writes is only used by the
+  // thread sealing it, so the file is finished without the lock, which
+  // would otherwise block the writes to the column family.
+  BlobLogWriter* writer = log->writer.get();
+  uint64_t file_number = writer->file_number();
+  Status s = writer->status();
+  if (s.ok()) {
+    auto meta = writer->NewSealedMeta();
+    s = blob_manager_->FinishFile(log->cf_id, meta, writer->ReleaseHandle());
+  }
+  if (s.ok()) {
+    log->storage->RemoveBlobLog(file_number);
+    TITAN_LOG_INFO(db_options_.info_log,
+                   "Titan sealed blob log %" PRIu64 " of CF %" PRIu32 ".",
+                   file_number, log->cf_id);
+  } else {
+    // The blob log stays readable, and is recovered on reopen.
+    TITAN_LOG_ERROR(db_options_.info_log,
+                    "Titan failed to seal blob log %" PRIu64 ": %s",
+                    file_number, s.ToString().c_str());
+  }
+  MutexLock l(log->mutex.get());
+  log->writer.reset();
+  log->sealing = false;
+  log->cv->SignalAll();
+  return s;
+}
+
+Status TitanDBImpl::SealBlobLogs(BlobLogInfo* info, bool sync_pending) {
+  std::vector<std::shared_ptr<BlobLog>> to_seal;
+  std::vector<std::shared_ptr<BlobLog>> to_sync;
+  {
+    MutexLock l(info->mutex.get());
+    info->active.reset();
+    auto& unsealed = info->unsealed;
+    unsealed.erase(std::remove_if(unsealed.begin(), unsealed.end(),
+                                  [](const std::shared_ptr<BlobLog>& log) {
+                                    return log->writer == nullptr;
+                                  }),
+                   unsealed.end());
+    for (auto& log : unsealed) {
+      log->full = true;
+      if (log->pending_writes == 0) {
+        to_seal.push_back(log);
+      } else if (sync_pending) {
+        // Keeps the writer while the log is synced without the lock.
+        log->pending_writes++;
+        to_sync.push_back(log);
+      }
+    }
+  }
+  Status s;
+  for (auto& log : to_sync) {
+    Status log_s = SyncBlobLog(log);
+    if (s.ok()) {
+      s = log_s;
+    }
+    MutexLock l(log->mutex.get());
+    log->pending_writes--;
+    if (log->pending_writes == 0) {
+      // The other pending writes finished meanwhile.
+      to_seal.push_back(log);
+    }
+  }
+  for (auto& log : to_seal) {
+    Status log_s = SealBlobLog(log);
+    if (s.ok()) {
+      s = log_s;
+    }
+  }
+  return s;
+}
+
+Status TitanDBImpl::SealAllBlobLogs() {
+  if (!has_blob_logs_.load(std::memory_order_acquire)) {
+    return Status::OK();
+  }
+  std::shared_ptr<const BlobLogMap> blob_logs =
+      std::atomic_load(&published_blob_logs_);
+  Status s;
+  for (auto& cf : *blob_logs) {
+    // The logs with pending writes are sealed by the last of them, or
+    // recovered on reopen.
+    Status seal_s = SealBlobLogs(cf.second.get(), false /*sync_pending*/);
+    if (s.ok()) {
+      s = seal_s;
+    }
+  }
+  return s;
+}
+
+void TitanDBImpl::OnFlushBegin(const FlushJobInfo& flush_job_info) {
+  if (!has_blob_logs_.load(std::memory_order_acquire)) {
+    return;
+  }
+  std::shared_ptr<const BlobLogMap> blob_logs =
+      std::atomic_load(&published_blob_logs_);
+  auto it = blob_logs->find(flush_job_info.cf_id);
+  if (it == blob_logs->end()) {
+    return;
+  }
+  // The blob logs are sealed, so that the values are visible to GC and
+  // backups like those of the flushed memtable. The blob indexes in the
+  // memtable point to the blob logs, which must be durable before the WAL
+  // is deleted after the flush.
+  Status s = SealBlobLogs(it->second.get(), true /*sync_pending*/);
+  if (!s.ok()) {
+    TITAN_LOG_ERROR(db_options_.info_log,
+                    "OnFlushBegin[%d]: failed to seal blob logs of CF %" PRIu32
+                    ": %s",
+                    flush_job_info.job_id, flush_job_info.cf_id,
+                    s.ToString().c_str());
+    MutexLock l(&mutex_);
+    SetBGError(s);
+  }
+}
+
+}  // namespace titandb
+}  // namespace rocksdb
@@ -6,8 +6,11 @@
 
 #include <cinttypes>
 
+#include <functional>
+#include <map>
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "db/arena_wrapped_db_iter.h"
 #include "db/db_iter.h"
@@ -37,13 +40,22 @@ class TitanDBIterator : public Iterator {
         info_log_(info_log) {}
 
   ~TitanDBIterator() {
+    size_t touched_files = files_.size();
+    for (auto file_number : lookahead_files_) {
+      if (files_.count(file_number) == 0) touched_files++;
+    }
     RecordInHistogram(statistics(stats_), TITAN_ITER_TOUCH_BLOB_FILE_COUNT,
-                      files_.size());
+                      touched_files);
   }
 
-  bool Valid() const override { return iter_->Valid() && status_.ok(); }
+  bool Valid() const override {
+    if (InWindow()) return status_.ok();
+    return iter_->Valid() && status_.ok();
+  }
 
   Status status() const override {
+    // Entries in the lookahead window have been read off the inner iter.
+    if (InWindow()) return status_;
     // assume volatile inner iter
     if (status_.ok()) {
       return iter_->status();
@@ -52,8 +64,19 @@ class TitanDBIterator : public Iterator {
     }
   }
 
+  // Sets the blob files a bounded scan may touch, so that the first
+  // forward seek prefetches the ranges of them to be read. See
+  // `TitanReadOptions::bounded_scan_prefetch_size`.
+  void SetScanFiles(const std::vector<uint64_t> &files) {
+    scan_files_.insert(files.begin(), files.end());
+  }
+
   void SeekToFirst() override {
+    ClearWindow();
     iter_->SeekToFirst();
+    if (!scan_files_.empty()) {
+      PrefetchBoundedScan([this]() { iter_->SeekToFirst(); });
+    }
     if (ShouldGetBlobValue()) {
       StopWatch seek_sw(clock_, statistics(stats_), TITAN_SEEK_MICROS);
       GetBlobValue();
@@ -62,6 +85,7 @@ class TitanDBIterator : public Iterator {
   }
 
   void SeekToLast() override {
+    ClearWindow();
     iter_->SeekToLast();
     if (ShouldGetBlobValue()) {
       StopWatch seek_sw(clock_, statistics(stats_), TITAN_SEEK_MICROS);
@@ -71,7 +95,11 @@ class TitanDBIterator : public Iterator {
   }
 
   void Seek(const Slice &target) override {
+    ClearWindow();
     iter_->Seek(target);
+    if (!scan_files_.empty()) {
+      PrefetchBoundedScan([this, &target]() { iter_->Seek(target); });
+    }
     if (ShouldGetBlobValue()) {
       StopWatch seek_sw(clock_, statistics(stats_), TITAN_SEEK_MICROS);
       GetBlobValue();
@@ -80,6 +108,7 @@ class TitanDBIterator : public Iterator {
   }
 
   void SeekForPrev(const Slice &target) override {
+    ClearWindow();
     iter_->SeekForPrev(target);
     if (ShouldGetBlobValue()) {
       StopWatch seek_sw(clock_, statistics(stats_), TITAN_SEEK_MICROS);
@@ -90,6 +119,11 @@ class TitanDBIterator : public Iterator {
 
   void Next() override {
     assert(Valid());
+    if (options_.blob_lookahead_window > 0 && !options_.key_only &&
+        !options_.lazy_blob_value) {
+      NextWithLookahead();
+      return;
+    }
     iter_->Next();
     if (ShouldGetBlobValue()) {
       StopWatch next_sw(clock_, statistics(stats_), TITAN_NEXT_MICROS);
@@ -100,6 +134,22 @@ class TitanDBIterator : public Iterator {
 
   void Prev() override {
     assert(Valid());
+    if (InWindow()) {
+      if (window_pos_ > 0) {
+        window_pos_--;
+        status_ = window_[window_pos_].status;
+        return;
+      }
+      // Moves the underlying iterator back to the current entry, which is
+      // the first one in the window.
+      std::string current = window_[window_pos_].key;
+      ClearWindow();
+      iter_->Seek(current);
+      if (!iter_->Valid()) {
+        status_ = iter_->status();
+        return;
+      }
+    }
     iter_->Prev();
     if (ShouldGetBlobValue()) {
       StopWatch prev_sw(clock_, statistics(stats_), TITAN_PREV_MICROS);
@@ -110,21 +160,212 @@ class TitanDBIterator : public Iterator {
 
   Slice key() const override {
     assert(Valid());
+    if (InWindow()) return window_[window_pos_].key;
     return iter_->key();
   }
 
   Slice value() const override {
     assert(Valid() && !options_.key_only);
     if (options_.key_only) return Slice();
+    if (InWindow()) {
+      const LookaheadEntry &entry = window_[window_pos_];
+      return entry.is_blob ? entry.record.value : Slice(entry.value);
+    }
     if (!iter_->IsBlob()) return iter_->value();
+    if (!blob_value_loaded_) {
+      ReadBlobValue();
+      if (!status_.ok()) return Slice();
+    }
     return record_.value;
   }
 
   bool seqno(SequenceNumber *number) const override {
+    if (InWindow()) {
+      const LookaheadEntry &entry = window_[window_pos_];
+      *number = entry.seqno;
+      return entry.has_seqno;
+    }
     return iter_->seqno(number);
   }
 
  private:
+  // An entry buffered by the blob value lookahead.
+  struct LookaheadEntry {
+    std::string key;
+    // The value of an entry stored inline in the base DB.
+    std::string value;
+    bool is_blob{false};
+    bool has_seqno{false};
+    SequenceNumber seqno{0};
+    BlobRecord record;
+    PinnableSlice buffer;
+    Status status;
+  };
+
+  bool InWindow() const { return window_pos_ < window_.size(); }
+
+  void ClearWindow() {
+    window_.clear();
+    window_pos_ = 0;
+  }
+
+  void NextWithLookahead() {
+    if (InWindow()) {
+      if (window_pos_ + 1 < window_.size()) {
+        window_pos_++;
+        status_ = window_[window_pos_].status;
+        RecordTick(statistics(stats_), TITAN_NUM_NEXT);
+        return;
+      }
+      // The underlying iterator stays at the last entry of the window
+      // unless it has been exhausted.
+      bool exhausted = !iter_->Valid();
+      ClearWindow();
+      if (exhausted) {
+        status_ = iter_->status();
+        return;
+      }
+    }
+    iter_->Next();
+    StopWatch next_sw(clock_, statistics(stats_), TITAN_NEXT_MICROS);
+    FillWindow();
+    RecordTick(statistics(stats_), TITAN_NUM_NEXT);
+  }
+
+  // Buffers up to `blob_lookahead_window` entries starting from the current
+  // position of the underlying iterator, and reads their blob values in one
+  // batch. The underlying iterator is left at the last buffered entry, or
+  // invalid if it is exhausted.
+  void FillWindow() {
+    assert(!InWindow());
+    window_.resize(options_.blob_lookahead_window);
+    size_t n = 0;
+    std::vector<size_t> positions;
+    std::vector<BlobIndex> indexes;
+    while (iter_->Valid() && n < window_.size()) {
+      if (n > 0) {
+        iter_->Next();
+        if (!iter_->Valid()) break;
+      }
+      LookaheadEntry &entry = window_[n++];
+      entry.key = iter_->key().ToString();
+      entry.has_seqno = iter_->seqno(&entry.seqno);
+      entry.is_blob = iter_->IsBlob();
+      if (!entry.is_blob) {
+        entry.value = iter_->value().ToString();
+        continue;
+      }
+      BlobIndex index;
+      entry.status = DecodeInto(iter_->value(), &index);
+      if (!entry.status.ok()) {
+        TITAN_LOG_ERROR(info_log_,
+                        "Titan iterator: failed to decode blob index %s: %s",
+                        iter_->value().ToString(true /*hex*/).c_str(),
+                        entry.status.ToString().c_str());
+        continue;
+      }
+      positions.push_back(n - 1);
+      indexes.push_back(index);
+      lookahead_files_.insert(index.file_number);
+    }
+    window_.resize(n);
+    if (n == 0) {
+      status_ = iter_->status();
+      return;
+    }
+
+    if (!indexes.empty()) {
+      std::vector<BlobRecord> records;
+      std::vector<PinnableSlice> buffers;
+      std::vector<Status> statuses;
+      storage_->MultiGet(options_, indexes, &records, &buffers, &statuses);
+      for (size_t i = 0; i < positions.size(); i++) {
+        LookaheadEntry &entry = window_[positions[i]];
+        entry.status = statuses[i];
+        if (!entry.status.ok()) {
+          TITAN_LOG_ERROR(
+              info_log_,
+              "Titan iterator: failed to read blob value from file %" PRIu64
+              ", offset %" PRIu64 ", size %" PRIu64 ": %s\n",
+              indexes[i].file_number, indexes[i].blob_handle.offset,
+              indexes[i].blob_handle.size, entry.status.ToString().c_str());
+          continue;
+        }
+        entry.record = records[i];
+        entry.buffer.PinSlice(entry.record.value, &buffers[i]);
+      }
+    }
+    window_pos_ = 0;
+    status_ = window_[0].status;
+  }
+
+  // Walks the blob indexes from the current position to the upper bound,
+  // and prefetches the range of each blob file covering the records to be
+  // read, up to `bounded_scan_prefetch_size` bytes in total. The walk also
+  // stops once the visited entries add up to that size, in case few of
+  // them point to the candidate files. The underlying iterator is
+  // positioned back by "reseek" afterwards. It is done once per iterator.
+  void PrefetchBoundedScan(const std::function<void()> &reseek) {
+    std::unordered_set<uint64_t> candidates;
+    candidates.swap(scan_files_);
+    // file number -> [start, end) of the records to be read
+    std::map<uint64_t, std::pair<uint64_t, uint64_t>> ranges;
+    uint64_t planned = 0;
+    uint64_t visited = 0;
+    for (; iter_->Valid(); iter_->Next()) {
+      visited += iter_->key().size() + iter_->value().size();
+      if (visited > options_.bounded_scan_prefetch_size) break;
+      if (!iter_->IsBlob()) continue;
+      BlobIndex index;
+      if (!DecodeInto(iter_->value(), &index).ok() ||
+          candidates.count(index.file_number) == 0) {
+        continue;
+      }
+      uint64_t start = index.blob_handle.offset;
+      uint64_t end = start + index.blob_handle.size;
+      auto it = ranges.find(index.file_number);
+      uint64_t growth = end - start;
+      if (it != ranges.end()) {
+        start = std::min(start, it->second.first);
+        end = std::max(end, it->second.second);
+        growth = (end - start) - (it->second.second - it->second.first);
+      }
+      if (planned + growth > options_.bounded_scan_prefetch_size) break;
+      planned += growth;
+      ranges[index.file_number] = std::make_pair(start, end);
+    }
+    reseek();
+
+    for (auto &range : ranges) {
+      // A failure is reported again when the file is read, and status_ is
+      // reset by the caller.
+      BlobFilePrefetcher *prefetcher = GetPrefetcher(range.first);
+      if (prefetcher == nullptr) continue;
+      prefetcher->PrefetchRange(options_, range.second.first,
+                                range.second.second - range.second.first);
+    }
+  }
+
+  // Returns the prefetcher of the blob file, creating it on first use.
+  // Returns nullptr and sets status_ on failure.
+  BlobFilePrefetcher *GetPrefetcher(uint64_t file_number) const {
+    auto it = files_.find(file_number);
+    if (it == files_.end()) {
+      std::unique_ptr<BlobFilePrefetcher> prefetcher;
+      status_ = storage_->NewPrefetcher(file_number, &prefetcher);
+      if (!status_.ok()) {
+        TITAN_LOG_ERROR(
+            info_log_,
+            "Titan iterator: failed to create prefetcher for blob file %" PRIu64
+            ": %s",
+            file_number, status_.ToString().c_str());
+        return nullptr;
+      }
+      it = files_.emplace(file_number, std::move(prefetcher)).first;
+    }
+    return it->second.get();
+  }
+
   bool ShouldGetBlobValue() {
     if (!iter_->Valid() || !iter_->IsBlob() || options_.key_only) {
       status_ = iter_->status();
@@ -136,8 +377,7 @@ class TitanDBIterator : public Iterator {
   void GetBlobValue() {
     assert(iter_->status().ok());
 
-    BlobIndex index;
-    status_ = DecodeInto(iter_->value(), &index);
+    status_ = DecodeInto(iter_->value(), &index_);
     if (!status_.ok()) {
       TITAN_LOG_ERROR(info_log_,
                       "Titan iterator: failed to decode blob index %s: %s",
@@ -145,44 +385,54 @@ class TitanDBIterator : public Iterator {
                       status_.ToString().c_str());
       return;
     }
-
-    auto it = files_.find(index.file_number);
-    if (it == files_.end()) {
-      std::unique_ptr<BlobFilePrefetcher> prefetcher;
-      status_ = storage_->NewPrefetcher(index.file_number, &prefetcher);
-      if (!status_.ok()) {
-        TITAN_LOG_ERROR(
-            info_log_,
-            "Titan iterator: failed to create prefetcher for blob file %" PRIu64
-            ": %s",
-            index.file_number, status_.ToString().c_str());
-        return;
-      }
-      it = files_.emplace(index.file_number, std::move(prefetcher)).first;
+    blob_value_loaded_ = false;
+    if (!options_.lazy_blob_value) {
+      ReadBlobValue();
     }
+  }
+
+  // Reads the blob value pointed by the current blob index. It is called
+  // by value() in lazy mode, so it is const.
+  void ReadBlobValue() const {
+    blob_value_loaded_ = true;
+    BlobFilePrefetcher *prefetcher = GetPrefetcher(index_.file_number);
+    if (prefetcher == nullptr) return;
 
     buffer_.Reset();
-    status_ = it->second->Get(options_, index.blob_handle, &record_, &buffer_);
+    status_ = prefetcher->Get(options_, index_.blob_handle, &record_, &buffer_);
     if (!status_.ok()) {
       TITAN_LOG_ERROR(
           info_log_,
           "Titan iterator: failed to read blob value from file %" PRIu64
           ", offset %" PRIu64 ", size %" PRIu64 ": %s\n",
-          index.file_number, index.blob_handle.offset, index.blob_handle.size,
-          status_.ToString().c_str());
+          index_.file_number, index_.blob_handle.offset,
+          index_.blob_handle.size, status_.ToString().c_str());
     }
-    return;
   }
 
-  Status status_;
-  BlobRecord record_;
-  PinnableSlice buffer_;
+  // Members below are mutable because the blob value is read by value()
+  // in lazy mode.
+  mutable Status status_;
+  BlobIndex index_;
+  mutable bool blob_value_loaded_{false};
+  mutable BlobRecord record_;
+  mutable PinnableSlice buffer_;
 
   TitanReadOptions options_;
   BlobStorage *storage_;
   std::shared_ptr<ManagedSnapshot> snap_;
   std::unique_ptr<ArenaWrappedDBIter> iter_;
-  std::unordered_map<uint64_t, std::unique_ptr<BlobFilePrefetcher>> files_;
+  mutable std::unordered_map<uint64_t, std::unique_ptr<BlobFilePrefetcher>>
+      files_;
+
+  // Entries buffered by the blob value lookahead, and the position of the
+  // current entry among them.
+  std::vector<LookaheadEntry> window_;
+  size_t window_pos_{0};
+  std::unordered_set<uint64_t> lookahead_files_;
+  // Blob files overlapping the bounded scan, cleared once the scan is
+  // planned.
+  std::unordered_set<uint64_t> scan_files_;
 
   SystemClock *clock_;
   TitanStats *stats_;
@@ -186,13 +186,16 @@ class EditCollector {
     }
 
     Status Apply(BlobStorage* storage) {
+      std::vector<std::shared_ptr<BlobFileMeta>> files;
+      files.reserve(added_files_.size());
       for (auto& file : added_files_) {
         // just skip paired added and deleted files
         if (deleted_files_.count(file.first) > 0) {
           continue;
         }
-        storage->AddBlobFile(file.second);
+        files.push_back(file.second);
       }
+      storage->AddBlobFiles(files);
 
       for (auto& file : deleted_files_) {
         auto number = file.first;
@@ -28,6 +28,18 @@ void TitanDBOptions::Dump(Logger* logger) const {
   TITAN_LOG_HEADER(logger,
                    "TitanDBOptions.titan_stats_dump_period_sec: %" PRIu32,
                    titan_stats_dump_period_sec);
+  TITAN_LOG_HEADER(logger, "TitanDBOptions.max_open_blob_files        : %d",
+                   max_open_blob_files);
+  TITAN_LOG_HEADER(logger, "TitanDBOptions.blob_file_cache_numshardbits: %d",
+                   blob_file_cache_numshardbits);
+  TITAN_LOG_HEADER(logger,
+                   "TitanDBOptions.async_blob_read_threads    : %" PRIi32,
+                   async_blob_read_threads);
+  TITAN_LOG_HEADER(logger, "TitanDBOptions.blob_cache_warmup          : %d",
+                   static_cast<int>(blob_cache_warmup));
+  TITAN_LOG_HEADER(logger,
+                   "TitanDBOptions.blob_cache_warmup_bytes_per_sec: %" PRIu64,
+                   blob_cache_warmup_bytes_per_sec);
 }
 
 TitanCFOptions::TitanCFOptions(const ColumnFamilyOptions& cf_opts,
@@ -37,7 +49,15 @@ TitanCFOptions::TitanCFOptions(const ColumnFamilyOptions& cf_opts,
       min_blob_size(immutable_opts.min_blob_size),
       blob_file_compression(immutable_opts.blob_file_compression),
       blob_file_target_size(immutable_opts.blob_file_target_size),
+      blob_value_chunk_size(immutable_opts.blob_value_chunk_size),
       blob_cache(immutable_opts.blob_cache),
+      blob_cache_compressed_ratio(immutable_opts.blob_cache_compressed_ratio),
+      blob_cache_admission_frequency(
+          immutable_opts.blob_cache_admission_frequency),
+      blob_cache_fill_on_flush(immutable_opts.blob_cache_fill_on_flush),
+      blob_cache_fill_on_gc(immutable_opts.blob_cache_fill_on_gc),
+      blob_batched_read(immutable_opts.blob_batched_read),
+      separate_blob_on_write(immutable_opts.separate_blob_on_write),
       max_gc_batch_size(immutable_opts.max_gc_batch_size),
       min_gc_batch_size(immutable_opts.min_gc_batch_size),
       blob_file_discardable_ratio(immutable_opts.blob_file_discardable_ratio),
@@ -70,14 +90,32 @@ void TitanCFOptions::Dump(Logger* logger) const {
                    blob_file_compression_options.max_dict_bytes);
   TITAN_LOG_HEADER(logger, "    zstd_max_train_bytes : %" PRIu32,
                    blob_file_compression_options.zstd_max_train_bytes);
+  TITAN_LOG_HEADER(logger, "    parallel_threads : %" PRIu32,
+                   blob_file_compression_options.parallel_threads);
   TITAN_LOG_HEADER(logger,
                    "TitanCFOptions.blob_file_target_size        : %" PRIu64,
                    blob_file_target_size);
+  TITAN_LOG_HEADER(logger,
+                   "TitanCFOptions.blob_value_chunk_size        : %" PRIu32,
+                   blob_value_chunk_size);
   TITAN_LOG_HEADER(logger, "TitanCFOptions.blob_cache                   : %p",
                    blob_cache.get());
   if (blob_cache != nullptr) {
     TITAN_LOG_HEADER(logger, "%s", blob_cache->GetPrintableOptions().c_str());
   }
+  TITAN_LOG_HEADER(logger, "TitanCFOptions.blob_cache_compressed_ratio  : %lf",
+                   blob_cache_compressed_ratio);
+  TITAN_LOG_HEADER(logger,
+                   "TitanCFOptions.blob_cache_admission_frequency: %" PRIu32,
+                   blob_cache_admission_frequency);
+  TITAN_LOG_HEADER(logger, "TitanCFOptions.blob_cache_fill_on_flush     : %d",
+                   static_cast<int>(blob_cache_fill_on_flush));
+  TITAN_LOG_HEADER(logger, "TitanCFOptions.blob_cache_fill_on_gc        : %d",
+                   static_cast<int>(blob_cache_fill_on_gc));
+  TITAN_LOG_HEADER(logger, "TitanCFOptions.blob_batched_read            : %d",
+                   static_cast<int>(blob_batched_read));
+  TITAN_LOG_HEADER(logger, "TitanCFOptions.separate_blob_on_write       : %d",
+                   static_cast<int>(separate_blob_on_write));
   TITAN_LOG_HEADER(logger,
                    "TitanCFOptions.max_gc_batch_size            : %" PRIu64,
                    max_gc_batch_size);
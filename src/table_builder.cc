@@ -99,7 +99,7 @@ void TitanTableBuilder::Add(const Slice& key, const Slice& value) {
       if (get_status.ok()) {
         gc_num_keys_relocated_++;
         gc_bytes_relocated_ += record.value.size();
-        AddBlob(ikey, record.value);
+        AddBlob(ikey, record.value, &index);
         if (ok()) return;
       } else {
         ++error_read_cnt_;
@@ -140,9 +140,11 @@ void TitanTableBuilder::AddBase(const Slice& key,
                                 const ParsedInternalKey& parsedKey,
                                 const Slice& value) {
   // "parsedKey" was parsed from "key" (i.e., an internal key).
-  if (builder_unbuffered()) {
+  if (builder_unbuffered() &&
+      (!blob_builder_ || blob_builder_->NumPendingEntries() == 0)) {
     // We can directly append this into SST safely, without disorder issue.
-    // Only when base_builder_ is in unbuffered state
+    // Only when base_builder_ is in unbuffered state, and no blob record is
+    // still being compressed.
     base_builder_->Add(key, value);
   } else {
     // We have to let builder to cache this KV pair, and it will be flushed to
@@ -154,7 +156,8 @@ void TitanTableBuilder::AddBase(const Slice& key,
 }
 
 void TitanTableBuilder::AddBlob(const ParsedInternalKey& ikey,
-                                const Slice& value) {
+                                const Slice& value,
+                                const BlobIndex* original_index) {
   if (!ok()) return;
 
   BlobRecord record;
@@ -181,8 +184,9 @@ void TitanTableBuilder::AddBlob(const ParsedInternalKey& ikey,
     TITAN_LOG_INFO(db_options_.info_log,
                    "Titan table builder created new blob file %" PRIu64 ".",
                    blob_handle_->GetNumber());
-    blob_builder_.reset(
-        new BlobFileBuilder(db_options_, cf_options_, blob_handle_->GetFile()));
+    blob_builder_.reset(new BlobFileBuilder(
+        db_options_, cf_options_, blob_handle_->GetFile(),
+        BlobFileHeader::kVersion2, compression_pool_));
   }
 
   RecordTick(statistics(stats_), TITAN_BLOB_FILE_NUM_KEYS_WRITTEN);
@@ -196,21 +200,36 @@ void TitanTableBuilder::AddBlob(const ParsedInternalKey& ikey,
       new BlobFileBuilder::BlobRecordContext);
   AppendInternalKey(&ctx->key, ikey);
   ctx->new_blob_index.file_number = blob_handle_->GetNumber();
+  if (ShouldFillBlobCache(original_index)) {
+    record.EncodeTo(&ctx->cache_record);
+  }
   blob_builder_->Add(record, std::move(ctx), &contexts);
 
   UpdateIOBytes(prev_bytes_read, prev_bytes_written, &io_bytes_read_,
                 &io_bytes_written_);
 
+  // The contexts output by `BlobFileBuilder::Finish` below, if any, follow
+  // these ones.
+  AddBlobResultsToBase(contexts);
+
   if (blob_handle_->GetFile()->GetFileSize() >=
       cf_options_.blob_file_target_size) {
     // if blob file hit the size limit, we have to finish it
-    // in this case, when calling `BlobFileBuilder::Finish`, builder will be in
-    // unbuffered state, so it will not trigger another `AddBlobResultsToBase`
-    // call
     FinishBlobFile();
   }
+}
 
-  AddBlobResultsToBase(contexts);
+bool TitanTableBuilder::ShouldFillBlobCache(const BlobIndex* original_index) {
+  if (!cf_options_.blob_cache) {
+    return false;
+  }
+  if (cf_options_.blob_cache_fill_on_flush) {
+    return true;
+  }
+  return original_index != nullptr && cf_options_.blob_cache_fill_on_gc &&
+         IsBlobCached(cf_options_.blob_cache.get(),
+                      BlobCacheKey(blob_cache_id_, original_index->file_number,
+                                   original_index->blob_handle.offset));
 }
 
 void TitanTableBuilder::AddBlobResultsToBase(
@@ -232,6 +251,13 @@ void TitanTableBuilder::AddBlobResultsToBase(
       bytes_written_ += ctx->new_blob_index.blob_handle.size;
       std::string index_value;
       ctx->new_blob_index.EncodeTo(&index_value);
+      if (!ctx->cache_record.empty()) {
+        InsertBlobCache(
+            cf_options_.blob_cache.get(),
+            BlobCacheKey(blob_cache_id_, ctx->new_blob_index.file_number,
+                         ctx->new_blob_index.blob_handle.offset),
+            ctx->cache_record);
+      }
 
       ikey.type = kTypeBlobIndex;
       std::string index_key;
@@ -331,7 +357,8 @@ void TitanTableBuilder::Abandon() {
 
 uint64_t TitanTableBuilder::NumEntries() const {
   if (builder_unbuffered()) {
-    return base_builder_->NumEntries();
+    return base_builder_->NumEntries() +
+           (blob_builder_ ? blob_builder_->NumPendingEntries() : 0);
   } else {
     return blob_builder_->NumEntries() + blob_builder_->NumSampleEntries();
   }
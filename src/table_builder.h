@@ -19,7 +19,9 @@ class TitanTableBuilder : public TableBuilder {
                     std::unique_ptr<TableBuilder> base_builder,
                     std::shared_ptr<BlobFileManager> blob_manager,
                     std::weak_ptr<BlobStorage> blob_storage, TitanStats* stats,
-                    int merge_level, int target_level)
+                    int merge_level, int target_level,
+                    uint32_t blob_cache_id = 0,
+                    ThreadPool* compression_pool = nullptr)
       : cf_id_(cf_id),
         db_options_(db_options),
         cf_options_(cf_options),
@@ -28,7 +30,9 @@ class TitanTableBuilder : public TableBuilder {
         blob_storage_(blob_storage),
         stats_(stats),
         target_level_(target_level),
-        merge_level_(merge_level) {}
+        merge_level_(merge_level),
+        blob_cache_id_(blob_cache_id),
+        compression_pool_(compression_pool) {}
 
   void Add(const Slice& key, const Slice& value) override;
 
@@ -67,7 +71,14 @@ class TitanTableBuilder : public TableBuilder {
   std::unique_ptr<BlobFileBuilder::BlobRecordContext> NewCachedRecordContext(
       const ParsedInternalKey& ikey, const Slice& value);
 
-  void AddBlob(const ParsedInternalKey& ikey, const Slice& value);
+  // Adds the value to the blob file. "original_index" is the blob index
+  // the value is relocated from by level merge, if any.
+  void AddBlob(const ParsedInternalKey& ikey, const Slice& value,
+               const BlobIndex* original_index = nullptr);
+
+  // Returns whether the value added to the blob file should be inserted
+  // into the blob cache as it is written.
+  bool ShouldFillBlobCache(const BlobIndex* original_index);
 
   void AddBlobResultsToBase(const BlobFileBuilder::OutContexts& contexts);
 
@@ -105,6 +116,10 @@ class TitanTableBuilder : public TableBuilder {
   // equals to merge_level_, values belong to blob files which have lower level
   // than target_level_ will be merged to new blob file
   int merge_level_;
+  // The cache id of the blob cache keys, see BlobCacheKey.
+  uint32_t blob_cache_id_;
+  // Runs the parallel compression of the blob files, see BlobFileBuilder.
+  ThreadPool* compression_pool_;
 
   // counters
   uint64_t bytes_read_ = 0;
@@ -228,8 +228,10 @@ class TableBuilderTest : public testing::Test {
     NewFileReader(blob_name_, &file);
     uint64_t file_size = 0;
     ASSERT_OK(env_->GetFileSize(blob_name_, &file_size));
-    ASSERT_OK(BlobFileReader::Open(cf_options_, std::move(file), file_size,
-                                   result, nullptr));
+    ASSERT_OK(BlobFileReader::Open(cf_options_, std::move(file),
+                                   kTestFileNumber, file_size, result,
+                                   nullptr /*stats*/,
+                                   env_->GetSystemClock().get()));
   }
 
   void NewTableReader(const uint64_t file_number,
@@ -563,6 +565,76 @@ TEST_F(TableBuilderTest, DictCompressDisorder) {
 #endif
 }
 
+TEST_F(TableBuilderTest, ParallelCompressionDisorder) {
+  cf_options_.blob_file_compression = kLZ4Compression;
+  cf_options_.blob_file_compression_options.parallel_threads = 4;
+
+  table_factory_.reset(new TitanTableFactory(
+      db_options_, cf_options_, db_impl_.get(), blob_manager_, &mutex_,
+      blob_file_set_.get(), nullptr));
+
+  std::unique_ptr<WritableFileWriter> base_file;
+  NewBaseFileWriter(&base_file);
+  std::unique_ptr<TableBuilder> table_builder;
+  NewTableBuilder(base_file_number_, base_file.get(), &table_builder);
+
+  // The small values are added while the blob records before them are
+  // still being compressed.
+  const int n = 100;
+  for (char i = 0; i < n; i++) {
+    std::string key(1, i);
+    InternalKey ikey(key, 1, kTypeValue);
+    std::string value;
+    if (i % 3 == 0) {
+      value = std::string(1, i);
+    } else {
+      value = std::string(kMinBlobSize, i);
+    }
+    table_builder->Add(ikey.Encode(), value);
+  }
+  ASSERT_EQ(n, table_builder->NumEntries());
+  ASSERT_OK(table_builder->Finish());
+  ASSERT_OK(base_file->Sync(true));
+  ASSERT_OK(base_file->Close());
+  std::unique_ptr<TableReader> base_reader;
+  NewTableReader(base_file_number_, &base_reader);
+  std::unique_ptr<BlobFileReader> blob_reader;
+  NewBlobFileReader(&blob_reader);
+
+  ReadOptions ro;
+  std::unique_ptr<InternalIterator> iter;
+  iter.reset(base_reader->NewIterator(ro, nullptr /*prefix_extractor*/,
+                                      nullptr /*arena*/, false /*skip_filters*/,
+                                      TableReaderCaller::kUncategorized));
+  iter->SeekToFirst();
+  uint64_t last_offset = 0;
+  for (char i = 0; i < n; i++) {
+    ASSERT_TRUE(iter->Valid());
+    std::string key(1, i);
+    ParsedInternalKey ikey;
+    ASSERT_OK(ParseInternalKey(iter->key(), &ikey, false));
+    ASSERT_EQ(ikey.user_key, key);
+    if (i % 3 == 0) {
+      ASSERT_EQ(ikey.type, kTypeValue);
+      ASSERT_EQ(iter->value(), std::string(1, i));
+    } else {
+      ASSERT_EQ(ikey.type, kTypeBlobIndex);
+      BlobIndex index;
+      ASSERT_OK(DecodeInto(iter->value(), &index));
+      ASSERT_EQ(index.file_number, kTestFileNumber);
+      // The records are written in the order they are added.
+      ASSERT_GT(index.blob_handle.offset, last_offset);
+      last_offset = index.blob_handle.offset;
+      BlobRecord record;
+      PinnableSlice buffer;
+      ASSERT_OK(blob_reader->Get(ro, index.blob_handle, &record, &buffer));
+      ASSERT_EQ(record.key, key);
+      ASSERT_EQ(record.value, std::string(kMinBlobSize, i));
+    }
+    iter->Next();
+  }
+}
+
 TEST_F(TableBuilderTest, NoBlob) {
   std::unique_ptr<WritableFileWriter> base_file;
   NewBaseFileWriter(&base_file);
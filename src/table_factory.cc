@@ -39,7 +39,9 @@ TableBuilder *TitanTableFactory::NewTableBuilder(
   return new TitanTableBuilder(
       options.column_family_id, db_options_, cf_options,
       std::move(base_builder), blob_manager_, blob_storage, stats_,
-      std::max(1, num_levels - 2) /* merge level */, options.level_at_creation);
+      std::max(1, num_levels - 2) /* merge level */, options.level_at_creation,
+      blob_file_set_->blob_cache_id(),
+      db_impl_->GetBlobCompressionPool(cf_options));
 }
 
 }  // namespace titandb
@@ -1,5 +1,6 @@
 #include <cinttypes>
 
+#include <future>
 #include <unordered_map>
 
 #include "db/db_impl/db_impl.h"
@@ -430,6 +431,327 @@ TEST_F(TitanDBTest, DbIter) {
   ASSERT_FALSE(iter->Valid());
 }
 
+TEST_F(TitanDBTest, DbIterLookahead) {
+  Open();
+  std::map<std::string, std::string> data;
+  const int kNumEntries = 100;
+  for (uint64_t i = 1; i <= kNumEntries; i++) {
+    Put(i, &data);
+  }
+  Flush();
+  ASSERT_EQ(kNumEntries, data.size());
+  TitanReadOptions ro;
+  ro.blob_lookahead_window = 8;
+  std::unique_ptr<Iterator> iter(db_->NewIterator(ro));
+  iter->SeekToFirst();
+  for (const auto& it : data) {
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(it.first, iter->key());
+    ASSERT_EQ(it.second, iter->value());
+    iter->Next();
+  }
+  ASSERT_FALSE(iter->Valid());
+  ASSERT_OK(iter->status());
+
+  // Changes direction inside and at the start of the lookahead window.
+  for (uint64_t i : {20, 25}) {
+    iter->Seek(GenKey(i));
+    for (int j = 0; j < 10; j++) {
+      iter->Next();
+    }
+    for (int j = 10; j >= 0; j--) {
+      ASSERT_TRUE(iter->Valid());
+      ASSERT_EQ(GenKey(i + j), iter->key());
+      ASSERT_EQ(data[GenKey(i + j)], iter->value());
+      iter->Prev();
+    }
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(GenKey(i - 1), iter->key());
+  }
+}
+
+TEST_F(TitanDBTest, DbIterLazyValue) {
+  Open();
+  std::map<std::string, std::string> data;
+  const int kNumEntries = 100;
+  for (uint64_t i = 1; i <= kNumEntries; i++) {
+    Put(i, &data);
+  }
+  Flush();
+
+  std::atomic<int> num_reads{0};
+  SyncPoint::GetInstance()->SetCallBack(
+      "BlobFileReader::Get", [&](void*) { num_reads++; });
+  SyncPoint::GetInstance()->EnableProcessing();
+
+  TitanReadOptions ro;
+  ro.lazy_blob_value = true;
+  std::unique_ptr<Iterator> iter(db_->NewIterator(ro));
+  int expected_reads = 0;
+  uint64_t i = 1;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next(), i++) {
+    ASSERT_EQ(GenKey(i), iter->key());
+    if (i % 3 == 0) {
+      ASSERT_EQ(data[GenKey(i)], iter->value());
+      // The value is read only once.
+      ASSERT_EQ(data[GenKey(i)], iter->value());
+      if (GenValue(i).size() >= options_.min_blob_size) {
+        expected_reads++;
+      }
+    }
+  }
+  ASSERT_OK(iter->status());
+  ASSERT_EQ(kNumEntries + 1, i);
+  ASSERT_EQ(expected_reads, num_reads.load());
+
+  SyncPoint::GetInstance()->DisableProcessing();
+  SyncPoint::GetInstance()->ClearAllCallBacks();
+}
+
+TEST_F(TitanDBTest, DbIterBoundedScanPrefetch) {
+  Open();
+  std::map<std::string, std::string> data;
+  const int kNumEntries = 100;
+  for (uint64_t i = 1; i <= kNumEntries; i++) {
+    Put(i, &data);
+  }
+  Flush();
+
+  std::vector<std::pair<uint64_t, uint64_t>> prefetches;
+  SyncPoint::GetInstance()->SetCallBack(
+      "BlobFilePrefetcher::Prefetch", [&](void* arg) {
+        prefetches.push_back(
+            *static_cast<std::pair<uint64_t, uint64_t>*>(arg));
+      });
+  SyncPoint::GetInstance()->EnableProcessing();
+
+  std::string upper_bound = GenKey(60);
+  Slice upper_bound_slice(upper_bound);
+  TitanReadOptions ro;
+  ro.iterate_upper_bound = &upper_bound_slice;
+  ro.bounded_scan_prefetch_size = 1 << 20;
+  std::unique_ptr<Iterator> iter(db_->NewIterator(ro));
+  uint64_t i = 20;
+  uint64_t blob_bytes = 0;
+  for (iter->Seek(GenKey(i)); iter->Valid(); iter->Next(), i++) {
+    ASSERT_EQ(GenKey(i), iter->key());
+    ASSERT_EQ(data[GenKey(i)], iter->value());
+    if (GenValue(i).size() >= options_.min_blob_size) {
+      blob_bytes += GenKey(i).size() + GenValue(i).size();
+    }
+  }
+  ASSERT_OK(iter->status());
+  ASSERT_EQ(60U, i);
+  // The records of the scan are read ahead at once by the seek.
+  ASSERT_EQ(1U, prefetches.size());
+  ASSERT_GE(prefetches[0].second, blob_bytes);
+
+  // Without the upper bound the scan is not planned.
+  prefetches.clear();
+  ro.iterate_upper_bound = nullptr;
+  iter.reset(db_->NewIterator(ro));
+  iter->Seek(GenKey(20));
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ(0U, prefetches.size());
+
+  SyncPoint::GetInstance()->DisableProcessing();
+  SyncPoint::GetInstance()->ClearAllCallBacks();
+}
+
+TEST_F(TitanDBTest, GetValueRange) {
+  options_.blob_file_compression = kNoCompression;
+  Open();
+  Random rnd(301);
+  std::string large_value = rnd.RandomString(64 << 10);
+  std::string small_value(options_.min_blob_size - 1, 's');
+  ASSERT_OK(db_->Put(WriteOptions(), "large", large_value));
+  ASSERT_OK(db_->Put(WriteOptions(), "small", small_value));
+  Flush();
+
+  std::atomic<int> num_full_reads{0};
+  SyncPoint::GetInstance()->SetCallBack(
+      "BlobFileReader::Get", [&](void*) { num_full_reads++; });
+  SyncPoint::GetInstance()->EnableProcessing();
+
+  PinnableSlice value;
+  ASSERT_OK(db_->GetValueRange(ReadOptions(), "large", 0, 4096, &value));
+  ASSERT_EQ(large_value.substr(0, 4096), value.ToString());
+  value.Reset();
+  ASSERT_OK(db_->GetValueRange(ReadOptions(), "large", 1000, 10, &value));
+  ASSERT_EQ(large_value.substr(1000, 10), value.ToString());
+  value.Reset();
+  // The range is cut at the end of the value.
+  ASSERT_OK(db_->GetValueRange(ReadOptions(), "large",
+                               large_value.size() - 10, 4096, &value));
+  ASSERT_EQ(large_value.substr(large_value.size() - 10), value.ToString());
+  value.Reset();
+  ASSERT_OK(db_->GetValueRange(ReadOptions(), "large", large_value.size(), 10,
+                               &value));
+  ASSERT_EQ("", value.ToString());
+  // Only the ranges are read from the blob file.
+  ASSERT_EQ(0, num_full_reads.load());
+
+  value.Reset();
+  ASSERT_OK(db_->GetValueRange(ReadOptions(), "small", 2, 5, &value));
+  ASSERT_EQ(small_value.substr(2, 5), value.ToString());
+  value.Reset();
+  ASSERT_TRUE(
+      db_->GetValueRange(ReadOptions(), "missing", 0, 10, &value).IsNotFound());
+
+  // A compressed record is read whole.
+  Close();
+  options_.blob_file_compression = kLZ4Compression;
+  Open();
+  std::string compressible_value(64 << 10, 'c');
+  ASSERT_OK(db_->Put(WriteOptions(), "compressed", compressible_value));
+  Flush();
+  value.Reset();
+  ASSERT_OK(db_->GetValueRange(ReadOptions(), "compressed", 100, 100, &value));
+  ASSERT_EQ(compressible_value.substr(100, 100), value.ToString());
+  ASSERT_EQ(1, num_full_reads.load());
+
+  SyncPoint::GetInstance()->DisableProcessing();
+  SyncPoint::GetInstance()->ClearAllCallBacks();
+}
+
+TEST_F(TitanDBTest, GetValueChunks) {
+  const size_t kChunkSize = 64 << 10;
+  options_.blob_file_compression = kNoCompression;
+  options_.blob_value_chunk_size = kChunkSize;
+  Open();
+  Random rnd(301);
+  std::string large_value = rnd.RandomString(1 << 20);
+  std::string small_value(options_.min_blob_size - 1, 's');
+  ASSERT_OK(db_->Put(WriteOptions(), "large", large_value));
+  ASSERT_OK(db_->Put(WriteOptions(), "small", small_value));
+  Flush();
+  // A value in chunks is still read whole by Get.
+  VerifyDB({{"large", large_value}, {"small", small_value}});
+
+  std::atomic<int> num_full_reads{0};
+  std::atomic<uint64_t> max_batch_size{0};
+  SyncPoint::GetInstance()->SetCallBack(
+      "BlobFileReader::Get", [&](void*) { num_full_reads++; });
+  SyncPoint::GetInstance()->SetCallBack(
+      "BlobFileReader::GetChunks:BatchSize", [&](void* arg) {
+        max_batch_size = std::max(max_batch_size.load(),
+                                  *reinterpret_cast<uint64_t*>(arg));
+      });
+  SyncPoint::GetInstance()->EnableProcessing();
+
+  std::vector<std::string> chunks;
+  auto collect = [&](const Slice& chunk) {
+    chunks.emplace_back(chunk.ToString());
+    return true;
+  };
+  ASSERT_OK(db_->GetValueChunks(ReadOptions(), "large", kChunkSize, collect));
+  ASSERT_EQ(large_value.size() / kChunkSize, chunks.size());
+  std::string value;
+  for (auto& chunk : chunks) {
+    ASSERT_LE(chunk.size(), kChunkSize);
+    value.append(chunk);
+  }
+  ASSERT_EQ(large_value, value);
+  ASSERT_EQ(0, num_full_reads.load());
+  // At most 4 chunks of the value are held in memory at once.
+  ASSERT_EQ(4 * kChunkSize, max_batch_size.load());
+
+  // Stops at the second chunk.
+  chunks.clear();
+  ASSERT_OK(db_->GetValueChunks(ReadOptions(), "large", kChunkSize,
+                                [&](const Slice& chunk) {
+                                  chunks.emplace_back(chunk.ToString());
+                                  return chunks.size() < 2;
+                                }));
+  ASSERT_EQ(2U, chunks.size());
+  ASSERT_EQ(large_value.substr(kChunkSize, kChunkSize), chunks[1]);
+
+  // Each chunk is verified before it is delivered, so only the chunks
+  // before a corrupted one are delivered.
+  std::atomic<int> num_verified{0};
+  SyncPoint::GetInstance()->SetCallBack(
+      "BlobValueChunks::Verify", [&](void* arg) {
+        if (++num_verified == 2) {
+          auto* crc = reinterpret_cast<uint32_t*>(arg);
+          *crc = *crc + 1;
+        }
+      });
+  chunks.clear();
+  ASSERT_TRUE(db_->GetValueChunks(ReadOptions(), "large", kChunkSize, collect)
+                  .IsCorruption());
+  ASSERT_EQ(1U, chunks.size());
+  ASSERT_EQ(large_value.substr(0, kChunkSize), chunks[0]);
+  SyncPoint::GetInstance()->ClearCallBack("BlobValueChunks::Verify");
+
+  chunks.clear();
+  ASSERT_OK(db_->GetValueChunks(ReadOptions(), "small", 10, collect));
+  // The small value is stored inline, 31 bytes.
+  ASSERT_EQ(4U, chunks.size());
+  ASSERT_EQ(small_value, chunks[0] + chunks[1] + chunks[2] + chunks[3]);
+  ASSERT_TRUE(db_->GetValueChunks(ReadOptions(), "small", 0, collect)
+                  .IsInvalidArgument());
+
+  SyncPoint::GetInstance()->DisableProcessing();
+  SyncPoint::GetInstance()->ClearAllCallBacks();
+}
+
+TEST_F(TitanDBTest, AsyncGet) {
+  Open();
+  std::map<std::string, std::string> data;
+  const int kNumEntries = 100;
+  for (uint64_t i = 1; i <= kNumEntries; i++) {
+    Put(i, &data);
+  }
+  Flush();
+
+  for (auto& kv : data) {
+    std::promise<std::pair<Status, std::string>> promise;
+    db_->AsyncGet(ReadOptions(), kv.first,
+                  [&](const Status& s, PinnableSlice* value) {
+                    promise.set_value(std::make_pair(s, value->ToString()));
+                  });
+    auto result = promise.get_future().get();
+    ASSERT_OK(result.first);
+    ASSERT_EQ(kv.second, result.second);
+  }
+
+  std::vector<ColumnFamilyHandle*> handles;
+  std::vector<Slice> keys;
+  for (auto& kv : data) {
+    handles.push_back(db_->DefaultColumnFamily());
+    keys.push_back(kv.first);
+  }
+  std::string missing_key = GenKey(kNumEntries + 1);
+  handles.push_back(db_->DefaultColumnFamily());
+  keys.push_back(missing_key);
+  std::promise<void> done;
+  db_->AsyncMultiGet(ReadOptions(), handles, keys,
+                     [&](std::vector<Status>* statuses,
+                         std::vector<PinnableSlice>* values) {
+                       size_t i = 0;
+                       for (auto& kv : data) {
+                         EXPECT_OK((*statuses)[i]);
+                         EXPECT_EQ(kv.second, (*values)[i].ToString());
+                         i++;
+                       }
+                       EXPECT_TRUE((*statuses)[i].IsNotFound());
+                       done.set_value();
+                     });
+  done.get_future().get();
+
+  // The scheduled async reads are served before the DB is closed.
+  std::atomic<int> num_callbacks{0};
+  for (auto& kv : data) {
+    db_->AsyncGet(ReadOptions(), kv.first,
+                  [&](const Status& s, PinnableSlice* /*value*/) {
+                    EXPECT_OK(s);
+                    num_callbacks++;
+                  });
+  }
+  Close();
+  ASSERT_EQ(kNumEntries, num_callbacks.load());
+}
+
 TEST_F(TitanDBTest, DBIterSeek) {
   Open();
   std::map<std::string, std::string> data;
@@ -1500,6 +1822,152 @@ TEST_F(TitanDBTest, UpdateValue) {
   Close();
 }
 
+TEST_F(TitanDBTest, PinnedGet) {
+  options_.min_blob_size = 1024;
+  std::vector<int> blob_cache_sizes = {0, 1024 * 1024};
+
+  for (auto blob_cache_size : blob_cache_sizes) {
+    options_.blob_cache = NewLRUCache(blob_cache_size);
+    Open();
+    ASSERT_OK(db_->Put(WriteOptions(), "k1", std::string(100, 'v')));
+    ASSERT_OK(db_->Put(WriteOptions(), "k2", std::string(64 * 1024, 'v')));
+    Flush();
+
+    for (int i = 0; i < 2; i++) {
+      PinnableSlice value;
+      ASSERT_OK(db_->Get(ReadOptions(), db_->DefaultColumnFamily(), "k2",
+                         &value));
+      // The blob value is pinned instead of being copied.
+      ASSERT_TRUE(value.IsPinned());
+      ASSERT_EQ(value.ToString(), std::string(64 * 1024, 'v'));
+      value.Reset();
+      ASSERT_OK(db_->Get(ReadOptions(), db_->DefaultColumnFamily(), "k1",
+                         &value));
+      ASSERT_EQ(value.ToString(), std::string(100, 'v'));
+    }
+    Close();
+    DeleteDir(env_, options_.dirname);
+    DeleteDir(env_, dbname_);
+  }
+}
+
+TEST_F(TitanDBTest, BlobCacheFillOnFlush) {
+  options_.blob_cache = NewLRUCache(1 << 20);
+  options_.blob_cache_fill_on_flush = true;
+  Open();
+  const int n = 100;
+  auto gen_value = [](int i) {
+    return std::string(100, static_cast<char>('a' + i % 26));
+  };
+  for (int i = 0; i < n; i++) {
+    ASSERT_OK(db_->Put(WriteOptions(), GenKey(i), gen_value(i)));
+  }
+  Flush();
+
+  // The records are cached as they are flushed.
+  uint64_t misses = options_.statistics->getTickerCount(TITAN_BLOB_CACHE_MISS);
+  for (int i = 0; i < n; i++) {
+    std::string value;
+    ASSERT_OK(db_->Get(ReadOptions(), GenKey(i), &value));
+    ASSERT_EQ(gen_value(i), value);
+  }
+  ASSERT_EQ(misses,
+            options_.statistics->getTickerCount(TITAN_BLOB_CACHE_MISS));
+}
+
+TEST_F(TitanDBTest, BlobCacheFillOnGC) {
+  options_.blob_file_discardable_ratio = 0.01;
+  options_.blob_cache = NewLRUCache(1 << 20);
+  options_.blob_cache_fill_on_gc = true;
+  Open();
+  const int n = 100;
+  auto gen_value = [](int i) {
+    return std::string(100, static_cast<char>('a' + i % 26));
+  };
+  for (int i = 0; i < n; i++) {
+    ASSERT_OK(db_->Put(WriteOptions(), GenKey(i), gen_value(i)));
+  }
+  Flush();
+  // Caches the even keys, and deletes the odd ones to make the file
+  // collected by GC.
+  for (int i = 0; i < n; i++) {
+    if (i % 2 == 0) {
+      std::string value;
+      ASSERT_OK(db_->Get(ReadOptions(), GenKey(i), &value));
+    } else {
+      Delete(i);
+    }
+  }
+  Flush();
+  CompactAll();
+  CheckBlobFileCount(1);
+  std::shared_ptr<BlobStorage> blob_storage = GetBlobStorage().lock();
+  ASSERT_TRUE(blob_storage != nullptr);
+  std::map<uint64_t, std::weak_ptr<BlobFileMeta>> blob_files;
+  blob_storage->ExportBlobFiles(blob_files);
+  uint64_t old_file_number = blob_files.begin()->first;
+
+  ASSERT_OK(db_impl_->TEST_StartGC(db_->DefaultColumnFamily()->GetID()));
+  ASSERT_OK(db_impl_->TEST_PurgeObsoleteFiles());
+  blob_files.clear();
+  blob_storage->ExportBlobFiles(blob_files);
+  ASSERT_EQ(1, blob_files.size());
+  ASSERT_GT(blob_files.begin()->first, old_file_number);
+
+  // The relocated records are still cached.
+  uint64_t misses = options_.statistics->getTickerCount(TITAN_BLOB_CACHE_MISS);
+  for (int i = 0; i < n; i += 2) {
+    std::string value;
+    ASSERT_OK(db_->Get(ReadOptions(), GenKey(i), &value));
+    ASSERT_EQ(gen_value(i), value);
+  }
+  ASSERT_EQ(misses,
+            options_.statistics->getTickerCount(TITAN_BLOB_CACHE_MISS));
+}
+
+TEST_F(TitanDBTest, BlobCacheWarmUp) {
+  options_.blob_cache = NewLRUCache(1 << 20);
+  options_.blob_cache_warmup = true;
+  Open();
+  const int n = 100;
+  auto gen_value = [](int i) {
+    return std::string(100, static_cast<char>('a' + i % 26));
+  };
+  for (int i = 0; i < n; i++) {
+    ASSERT_OK(db_->Put(WriteOptions(), GenKey(i), gen_value(i)));
+  }
+  Flush();
+  for (int i = 0; i < n; i += 2) {
+    std::string value;
+    ASSERT_OK(db_->Get(ReadOptions(), GenKey(i), &value));
+  }
+
+  // Reopens with an empty blob cache, which is warmed up with the records
+  // cached before in the background.
+  options_.blob_cache = NewLRUCache(1 << 20);
+  SyncPoint::GetInstance()->LoadDependency(
+      {{"TitanDBImpl::WarmUpBlobCache:Finish",
+        "TitanDBTest::BlobCacheWarmUp:WaitForWarmUp"}});
+  SyncPoint::GetInstance()->EnableProcessing();
+  Reopen();
+  TEST_SYNC_POINT("TitanDBTest::BlobCacheWarmUp:WaitForWarmUp");
+  SyncPoint::GetInstance()->DisableProcessing();
+
+  uint64_t misses = options_.statistics->getTickerCount(TITAN_BLOB_CACHE_MISS);
+  for (int i = 0; i < n; i += 2) {
+    std::string value;
+    ASSERT_OK(db_->Get(ReadOptions(), GenKey(i), &value));
+    ASSERT_EQ(gen_value(i), value);
+  }
+  ASSERT_EQ(misses,
+            options_.statistics->getTickerCount(TITAN_BLOB_CACHE_MISS));
+  // The records not cached before are not loaded.
+  std::string value;
+  ASSERT_OK(db_->Get(ReadOptions(), GenKey(1), &value));
+  ASSERT_EQ(misses + 1,
+            options_.statistics->getTickerCount(TITAN_BLOB_CACHE_MISS));
+}
+
 TEST_F(TitanDBTest, MultiGet) {
   options_.min_blob_size = 1024;
   std::vector<int> blob_cache_sizes = {0, 15 * 1024};
@@ -1964,6 +2432,235 @@ TEST_F(TitanDBTest, DeleteFilesInRangeDuringGC) {
   SyncPoint::GetInstance()->DisableProcessing();
 }
 
+TEST_F(TitanDBTest, SeparateBlobOnWrite) {
+  options_.separate_blob_on_write = true;
+  Open();
+  std::map<std::string, std::string> data;
+  for (uint64_t i = 0; i < 100; i++) {
+    Put(i, &data);
+  }
+  // The values are read from the blob log before it is sealed.
+  VerifyDB(data);
+  CheckBlobFileCount(0);
+  // The flush only sees the blob indexes, so it builds no blob file, but
+  // seals the blob log.
+  Flush();
+  CheckBlobFileCount(1);
+  VerifyDB(data);
+  Reopen();
+  CheckBlobFileCount(1);
+  VerifyDB(data);
+  std::shared_ptr<BlobStorage> blob_storage = GetBlobStorage().lock();
+  ASSERT_TRUE(blob_storage != nullptr);
+  std::map<uint64_t, std::weak_ptr<BlobFileMeta>> blob_files;
+  blob_storage->ExportBlobFiles(blob_files);
+  auto file = blob_files.begin()->second.lock();
+  ASSERT_EQ(file->file_entries(), data.size() / 2);
+  ASSERT_EQ(file->smallest_key(), GenKey(1));
+  ASSERT_EQ(file->largest_key(), GenKey(99));
+}
+
+TEST_F(TitanDBTest, SeparateBlobOnWriteRecovery) {
+  options_.separate_blob_on_write = true;
+  Open();
+  std::map<std::string, std::string> data;
+  for (uint64_t i = 0; i < 100; i++) {
+    Put(i, &data);
+  }
+  // Leaves the blob log unsealed, as if the DB crashed.
+  SyncPoint::GetInstance()->SetCallBack(
+      "TitanDBImpl::Close:SealBlobLogs",
+      [](void* arg) { *static_cast<bool*>(arg) = false; });
+  SyncPoint::GetInstance()->EnableProcessing();
+  Reopen();
+  SyncPoint::GetInstance()->DisableProcessing();
+  SyncPoint::GetInstance()->ClearAllCallBacks();
+  CheckBlobFileCount(1);
+  VerifyDB(data);
+
+  for (uint64_t i = 100; i < 200; i++) {
+    Put(i, &data);
+  }
+  Flush();
+  Reopen();
+  CheckBlobFileCount(2);
+  VerifyDB(data);
+}
+
+TEST_F(TitanDBTest, SeparateBlobOnWriteObsoleteLog) {
+  options_.separate_blob_on_write = true;
+  options_.blob_file_discardable_ratio = 0.01;
+  Open();
+  ASSERT_OK(db_->Put(WriteOptions(), "bar", std::string(100, 'v')));
+  ASSERT_OK(db_->Put(WriteOptions(), "foo", std::string(100, 'v')));
+  // Seals the blob log on close.
+  Reopen();
+  std::map<uint64_t, std::weak_ptr<BlobFileMeta>> blob_files;
+  GetBlobStorage().lock()->ExportBlobFiles(blob_files);
+  ASSERT_EQ(1, blob_files.size());
+  uint64_t log_number = blob_files.begin()->first;
+
+  ASSERT_OK(db_->Delete(WriteOptions(), "foo"));
+  Flush();
+  CompactAll();
+  ASSERT_OK(db_impl_->TEST_StartGC(db_->DefaultColumnFamily()->GetID()));
+  ASSERT_EQ(2, GetBlobStorage().lock()->NumBlobFiles());
+  auto log = GetBlobStorage().lock()->FindFile(log_number).lock();
+  ASSERT_TRUE(log != nullptr && log->is_obsolete());
+  log.reset();
+
+  // Reopens before the obsolete blob log is purged, which must not bring it
+  // back as a blob log never sealed.
+  ASSERT_OK(env_->FileExists(BlobFileName(options_.dirname, log_number)));
+  Reopen();
+  ASSERT_TRUE(GetBlobStorage().lock()->FindFile(log_number).expired());
+  std::string log_name = BlobFileName(options_.dirname, log_number);
+  ASSERT_TRUE(env_->FileExists(log_name).IsNotFound());
+  CheckBlobFileCount(1);
+  VerifyDB({{"bar", std::string(100, 'v')}});
+}
+
+TEST_F(TitanDBTest, SeparateBlobOnWriteGC) {
+  options_.separate_blob_on_write = true;
+  options_.blob_file_discardable_ratio = 0.01;
+  Open();
+  std::map<std::string, std::string> data;
+  for (uint64_t i = 0; i < 100; i++) {
+    Put(i, &data);
+  }
+  Flush();
+  std::map<uint64_t, std::weak_ptr<BlobFileMeta>> blob_files;
+  GetBlobStorage().lock()->ExportBlobFiles(blob_files);
+  ASSERT_EQ(1, blob_files.size());
+  uint64_t log_number = blob_files.begin()->first;
+
+  for (uint64_t i = 0; i < 50; i++) {
+    Delete(i);
+    data.erase(GenKey(i));
+  }
+  Flush();
+  CompactAll();
+  // The sealed blob log is rewritten by GC like a blob file.
+  ASSERT_OK(db_impl_->TEST_StartGC(db_->DefaultColumnFamily()->GetID()));
+  CheckBlobFileCount(1);
+  ASSERT_TRUE(GetBlobStorage().lock()->FindFile(log_number).expired());
+  VerifyDB(data);
+  Reopen();
+  CheckBlobFileCount(1);
+  VerifyDB(data);
+}
+
+TEST_F(TitanDBTest, SeparateBlobOnWriteTornLog) {
+  options_.separate_blob_on_write = true;
+  Open();
+  std::map<std::string, std::string> data;
+  WriteOptions wopts;
+  wopts.sync = true;
+  for (uint64_t i = 0; i < 100; i++) {
+    data[GenKey(i)] = GenValue(i);
+    ASSERT_OK(db_->Put(wopts, GenKey(i), GenValue(i)));
+  }
+  // Leaves the blob log unsealed with a torn record, as if the DB crashed
+  // while appending to it.
+  SyncPoint::GetInstance()->SetCallBack(
+      "TitanDBImpl::Close:SealBlobLogs",
+      [](void* arg) { *static_cast<bool*>(arg) = false; });
+  SyncPoint::GetInstance()->EnableProcessing();
+  Close();
+  SyncPoint::GetInstance()->DisableProcessing();
+  SyncPoint::GetInstance()->ClearAllCallBacks();
+  std::vector<std::string> children;
+  ASSERT_OK(env_->GetChildren(options_.dirname, &children));
+  std::vector<std::string> logs;
+  for (auto& child : children) {
+    if (Slice(child).ends_with(".blob")) {
+      logs.push_back(options_.dirname + "/" + child);
+    }
+  }
+  ASSERT_EQ(1, logs.size());
+  std::unique_ptr<WritableFile> file;
+  ASSERT_OK(env_->ReopenWritableFile(logs[0], &file, EnvOptions()));
+  ASSERT_OK(file->Append(std::string(10, 't')));
+  ASSERT_OK(file->Close());
+
+  Open();
+  CheckBlobFileCount(1);
+  VerifyDB(data);
+  for (uint64_t i = 100; i < 200; i++) {
+    Put(i, &data);
+  }
+  Flush();
+  CheckBlobFileCount(2);
+  Reopen();
+  CheckBlobFileCount(2);
+  VerifyDB(data);
+}
+
+TEST_F(TitanDBTest, SeparateBlobOnWriteConcurrent) {
+  options_.separate_blob_on_write = true;
+  options_.blob_file_target_size = 4 << 10;
+  Open();
+  const int kNumThreads = 4;
+  const uint64_t kNumKeys = 200;
+  std::vector<port::Thread> writers;
+  for (int t = 0; t < kNumThreads; t++) {
+    writers.emplace_back([&, t]() {
+      for (uint64_t i = t; i < kNumKeys * kNumThreads; i += kNumThreads) {
+        WriteOptions wopts;
+        wopts.sync = (i % 3 == 0);
+        ASSERT_OK(db_->Put(wopts, GenKey(i), GenValue(i)));
+      }
+    });
+  }
+  // The blob logs are sealed while the writers append to them.
+  for (int i = 0; i < 5; i++) {
+    Flush();
+  }
+  for (auto& writer : writers) {
+    writer.join();
+  }
+  std::map<std::string, std::string> data;
+  for (uint64_t i = 0; i < kNumKeys * kNumThreads; i++) {
+    data[GenKey(i)] = GenValue(i);
+  }
+  VerifyDB(data);
+  Flush();
+  Reopen();
+  VerifyDB(data);
+}
+
+TEST_F(TitanDBTest, SeparateBlobOnWriteSealInBackground) {
+  options_.separate_blob_on_write = true;
+  options_.blob_file_target_size = 4 << 10;
+  // The full blob logs are sealed by the GC thread pool.
+  options_.disable_background_gc = false;
+  Open();
+  std::map<std::string, std::string> data;
+  for (uint64_t i = 0; i < 100; i++) {
+    Put(i, &data);
+    // The logs are readable before and after they are sealed.
+    std::string value;
+    ASSERT_OK(db_->Get(ReadOptions(), GenKey(i), &value));
+    ASSERT_EQ(GenValue(i), value);
+  }
+  Flush();
+  VerifyDB(data);
+  Reopen();
+  VerifyDB(data);
+}
+
+TEST_F(TitanDBTest, SeparateBlobOnWriteCreateColumnFamily) {
+  Open();
+  TitanCFOptions cf_options(options_);
+  cf_options.separate_blob_on_write = true;
+  cf_options.blob_file_compression_options.max_dict_bytes = 4 << 10;
+  ColumnFamilyHandle* handle = nullptr;
+  ASSERT_TRUE(
+      db_->CreateColumnFamily(TitanCFDescriptor("cf", cf_options), &handle)
+          .IsNotSupported());
+  ASSERT_EQ(nullptr, handle);
+}
+
 TEST_F(TitanDBTest, Config) {
   options_.disable_background_gc = false;
 
@@ -1,6 +1,7 @@
 #include "util.h"
 
 #include "util/compression.h"
+#include "util/hash.h"
 #include "util/stop_watch.h"
 
 namespace rocksdb {
@@ -42,6 +43,60 @@ Status Uncompress(const UncompressionInfo& info, const Slice& input,
   return Status::OK();
 }
 
+FrequencySketch::FrequencySketch(size_t num_counters) : width_(1) {
+  while (width_ < num_counters) {
+    width_ <<= 1;
+  }
+  sample_size_ = 10 * width_;
+  counters_.reset(new std::atomic<uint8_t>[kDepth * width_]);
+  for (size_t i = 0; i < kDepth * width_; i++) {
+    counters_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+size_t FrequencySketch::Index(uint64_t hash, int row) const {
+  // Derives the hash of each row from the two halves of one hash.
+  uint32_t h1 = static_cast<uint32_t>(hash);
+  uint32_t h2 = static_cast<uint32_t>(hash >> 32);
+  return row * width_ + ((h1 + row * h2) & (width_ - 1));
+}
+
+uint32_t FrequencySketch::Increment(const Slice& key) {
+  uint64_t hash = Hash64(key.data(), key.size(), 0);
+  uint32_t count = kMaxCount;
+  for (int row = 0; row < kDepth; row++) {
+    auto& counter = counters_[Index(hash, row)];
+    uint8_t c = counter.load(std::memory_order_relaxed);
+    if (c < kMaxCount) {
+      counter.store(++c, std::memory_order_relaxed);
+    }
+    count = std::min<uint32_t>(count, c);
+  }
+  if (num_accesses_.fetch_add(1, std::memory_order_relaxed) + 1 >=
+      sample_size_) {
+    Age();
+  }
+  return count;
+}
+
+uint32_t FrequencySketch::Estimate(const Slice& key) const {
+  uint64_t hash = Hash64(key.data(), key.size(), 0);
+  uint32_t count = kMaxCount;
+  for (int row = 0; row < kDepth; row++) {
+    count = std::min<uint32_t>(
+        count, counters_[Index(hash, row)].load(std::memory_order_relaxed));
+  }
+  return count;
+}
+
+void FrequencySketch::Age() {
+  num_accesses_.store(sample_size_ / 2, std::memory_order_relaxed);
+  for (size_t i = 0; i < kDepth * width_; i++) {
+    counters_[i].store(counters_[i].load(std::memory_order_relaxed) >> 1,
+                       std::memory_order_relaxed);
+  }
+}
+
 void UnrefCacheHandle(void* arg1, void* arg2) {
   Cache* cache = reinterpret_cast<Cache*>(arg1);
   Cache::Handle* h = reinterpret_cast<Cache::Handle*>(arg2);
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+
 #include "file/writable_file_writer.h"
 #include "options/db_options.h"
 #include "rocksdb/cache.h"
@@ -25,6 +27,9 @@ class OwnedSlice : public Slice {
     buffer_ = std::move(buffer);
   }
 
+  // Returns whether the data is stored in the owned buffer.
+  bool owns_data() const { return buffer_ != nullptr; }
+
   char* release() {
     data_ = nullptr;
     size_ = 0;
@@ -51,6 +56,37 @@ class FixedSlice : public Slice {
   char buffer_[T];
 };
 
+// An approximate counter of the recent accesses of keys, as used by
+// TinyLFU. It is a count-min sketch whose counts are halved after every
+// "10 * num_counters" accesses, so that old accesses fade out. It is
+// thread-safe, concurrent updates may be lost which is fine for an
+// estimation.
+class FrequencySketch {
+ public:
+  // "num_counters" is rounded up to a power of two.
+  explicit FrequencySketch(size_t num_counters);
+
+  // Records an access of the key, and returns its estimated number of
+  // recent accesses including this one.
+  uint32_t Increment(const Slice& key);
+
+  // Returns the estimated number of recent accesses of the key.
+  uint32_t Estimate(const Slice& key) const;
+
+ private:
+  static const int kDepth = 4;
+  static const uint8_t kMaxCount = 15;
+
+  size_t Index(uint64_t hash, int row) const;
+  // Halves all the counts.
+  void Age();
+
+  size_t width_;
+  size_t sample_size_;
+  std::unique_ptr<std::atomic<uint8_t>[]> counters_;
+  std::atomic<size_t> num_accesses_{0};
+};
+
 // Compresses the input data according to the compression context.
 // Returns a slice with the output data and sets "*type" to the output
 // compression type.
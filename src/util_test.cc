@@ -30,6 +30,28 @@ TEST(UtilTest, Compression) {
   }
 }
 
+TEST(UtilTest, FrequencySketch) {
+  FrequencySketch sketch(1000);
+  ASSERT_EQ(0, sketch.Estimate("a"));
+  ASSERT_EQ(1, sketch.Increment("a"));
+  ASSERT_EQ(2, sketch.Increment("a"));
+  ASSERT_EQ(2, sketch.Estimate("a"));
+  ASSERT_EQ(1, sketch.Increment("b"));
+
+  // Counts are saturated.
+  for (int i = 0; i < 100; i++) {
+    sketch.Increment("b");
+  }
+  ASSERT_EQ(15, sketch.Estimate("b"));
+
+  // The counts are halved after 10 * 1024 accesses.
+  for (int i = 0; i < 10240 - 103; i++) {
+    sketch.Increment("c");
+  }
+  ASSERT_EQ(1, sketch.Estimate("a"));
+  ASSERT_EQ(7, sketch.Estimate("b"));
+}
+
 }  // namespace titandb
 }  // namespace rocksdb
 
@@ -63,6 +63,7 @@ class VersionTest : public testing::Test {
           new BlobStorage(db_options_, cf_options_, id, file_cache_, nullptr));
       blob_file_set_->column_families_.emplace(id, storage);
     }
+    blob_file_set_->PublishColumnFamilies();
   }
 
   void AddBlobFiles(uint32_t cf_id, uint64_t start, uint64_t end) {
@@ -101,12 +102,20 @@ class VersionTest : public testing::Test {
         auto iter = it.second->files_.find(f.first);
         ASSERT_TRUE(iter != it.second->files_.end());
         ASSERT_EQ(*f.second, *(iter->second));
+        // The published file table must be in sync.
+        ASSERT_EQ(it.second->FindFile(f.first).lock(), iter->second);
       }
     }
   }
 
   void CheckColumnFamiliesSize(uint64_t size) {
     ASSERT_EQ(blob_file_set_->column_families_.size(), size);
+    // The published copy must be in sync.
+    ASSERT_EQ(blob_file_set_->published_column_families_->size(), size);
+    for (auto& it : blob_file_set_->column_families_) {
+      ASSERT_EQ(blob_file_set_->GetBlobStorageUnlocked(it.first).lock(),
+                it.second);
+    }
   }
 
   void LegacyEncode(const VersionEdit& edit, std::string* dst) {